@@ -1,12 +1,31 @@
 #include "application.hpp"
+#include "mesh_cache.hpp"
+#include "thread_pool.hpp"
+#include "texture_streamer.hpp"
+#include "uniform_ring.hpp"
+#include "render_queue.hpp"
+#include "frame_stats.hpp"
+#include "static_scene.hpp"
+#include "culling.hpp"
+#include "hiz.hpp"
+#include "lights.hpp"
+#include "deferred.hpp"
+#include "clusters.hpp"
+#include "program_cache.hpp"
+#include "shader_reload.hpp"
+#include "gpu_profiler.hpp"
+#include "trace.hpp"
+#include "frame_clock.hpp"
+#include <chrono>
+#include <algorithm>
+#include <dirent.h>
+#include <cstring>
+#include <stdint.h>
+#include <unordered_map>
 #define STB_IMAGE_IMPLEMENTATION
 #include "include/stb_image.h"
 
 
-// models
-std::vector<Vertex> walls_model, chair_model, windows_model, balcony_model, podium_model, statue_model,
-                    stand_model, floor_model, spot_model, train_model, pillar_model;
-
 // main pointlight properties
 static glm::vec4 light_position = glm::vec4(0.2f, 4.5f, 0.7f, 1.0f);
 
@@ -14,76 +33,296 @@ static glm::vec4 light_position = glm::vec4(0.2f, 4.5f, 0.7f, 1.0f);
 glm::vec3 spotlight_position = glm::vec3(3.5f, 6.0f, -1.15f);
 glm::vec3 spotlight_direction = glm::vec3(0.0f, -1.0f, 0.0f);
 
+// static scene command ranges, built in init(), one per texture as a multi-draw call binds one
+enum StaticTexturedDraw { STATIC_WALLS, STATIC_BALCONY, STATIC_PODIUM, STATIC_STAND, STATIC_TEXTURED_COUNT };
+static IndirectDraw static_textured_draws[STATIC_TEXTURED_COUNT], static_floor_draw, static_windows_draw;
+
+// target of the frame, replaces the default framebuffer when there is no window
+static GLuint scene_framebuffer = 0;
+
+// simulated state of the step before the last one, rendered states are interpolated from it
+static glm::vec3 previous_eye_pos = camera.eye_pos;
+static float previous_train_angle = 0.0f;
+
+// WASD held down, the camera moves every simulation step
+static bool move_forward = false, move_back = false, move_left = false, move_right = false;
+
+// CPU culling, one box per object outside the packed scene, the packed meshes only on the per-mesh
+// path as the culling pass covers them on the multi-draw path
+enum PackedMesh {
+	MESH_FLOOR, MESH_PODIUM, MESH_STAND, MESH_BALCONY, MESH_PILLAR, MESH_WALLS, MESH_WINDOWS, PACKED_MESH_COUNT
+};
+enum SceneObject { OBJECT_STATUE, OBJECT_TRAIN, OBJECT_COUNT };
+static BoundingBoxes mesh_boxes, object_boxes, chair_boxes;
+static std::vector<uint8_t> mesh_visible, object_visible, chair_visible;
+
+// chair grid, kept for compacting the visible instances every frame
+static std::vector<InstanceData> chair_instances;
+
 /* ========== METHODS ========== */
 
-void init() 
+// start of init(), origin of the asset timeline
+static std::chrono::steady_clock::time_point init_start;
+
+// decodes textures and parses meshes
+static std::unique_ptr<ThreadPool> asset_loader;
+
+// one row of the startup timeline, times in ms since init_start
+struct AssetTiming {
+	std::string name;
+	double decode_start, decode_end;
+	double upload_start, upload_end;
+};
+static std::vector<AssetTiming> asset_timeline;
+
+// result of a loader thread job
+template <typename T>
+struct Decoded {
+	T data;
+	double start, end;
+};
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
 {
-	// programs
-	floor_program   = createProgram("shaders/default.vert", "shaders/procedural_parquet.frag");
-	texture_program = createProgram("shaders/default.vert", "shaders/texture.frag");
-	skybox_program  = createProgram("shaders/skybox.vert" , "shaders/skybox.frag");
-	statue_program  = createProgram("shaders/default.vert", "shaders/statue.frag");
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
-	// textures
-	walls_texture 	   = createTexture("images/walls.png");
-	stand_texture 	   = createTexture("images/stand.png");
-	light_wood_texture = createTexture("images/chair.png");
-	dark_wood_texture  = createTexture("images/podium.png");
-	balcony_texture	   = createTexture("images/balcony.png");
-	gold_texture  	   = createTexture("images/gold.png");
-
-	// models
-	walls_model   = loadOBJFile("obj/walls.obj");
-	chair_model   = loadOBJFile("obj/chair.obj");
-	windows_model = loadOBJFile("obj/windows.obj");
-	balcony_model = loadOBJFile("obj/balcony.obj");
-	podium_model  = loadOBJFile("obj/podium.obj");
-	statue_model  = loadOBJFile("obj/statue.obj");
-	stand_model   = loadOBJFile("obj/stand.obj");
-	floor_model   = loadOBJFile("obj/floor.obj");
-	train_model	  = loadOBJFile("obj/train.obj");
-	pillar_model  = loadOBJFile("obj/pillar.obj");
-
-	// VBOs
-	walls_vbo   = createObjectVBO(walls_model);
-	chair_vbo   = createObjectVBO(chair_model);
-	stand_vbo   = createObjectVBO(stand_model);
-	windows_vbo = createObjectVBO(windows_model);
-	balcony_vbo = createObjectVBO(balcony_model);
-	podium_vbo  = createObjectVBO(podium_model);
-	statue_vbo  = createObjectVBO(statue_model);
-	floor_vbo   = createObjectVBO(floor_model);
-	train_vbo   = createObjectVBO(train_model);
-	pillar_vbo  = createObjectVBO(pillar_model);
-
-	// VAOs
-	walls_vao   = createObjectVAO(walls_vbo);
-	chair_vao   = createObjectVAO(chair_vbo);
-	stand_vao   = createObjectVAO(stand_vbo);
-	windows_vao = createObjectVAO(windows_vbo);
-	balcony_vao = createObjectVAO(balcony_vbo);
-	podium_vao  = createObjectVAO(podium_vbo);
-	statue_vao  = createObjectVAO(statue_vbo);
-	floor_vao   = createObjectVAO(floor_vbo);
-	train_vao   = createObjectVAO(train_vbo);
-	pillar_vao  = createObjectVAO(pillar_vbo);
-
-	/* ==================== UNIFORMS ==================== */
+static std::future<ImageData> loadImageAsync(ThreadPool& loader, const char* file_name, bool flip)
+{
+	return loader.submit([file_name, flip]() {
+		traceThreadName("loader");
+		TraceScope trace("decode image", file_name);
+		return loadImage(file_name, flip);
+	});
+}
+
+static std::future<Decoded<MeshData> > loadMeshAsync(ThreadPool& loader, const char* file_name)
+{
+	return loader.submit([file_name]() {
+		traceThreadName("loader");
+		TraceScope trace("load mesh", file_name);
+		Decoded<MeshData> mesh;
+		mesh.start = millisecondsSince(init_start);
+		mesh.data = loadMeshData(file_name);
+		mesh.end = millisecondsSince(init_start);
+		return mesh;
+	});
+}
+
+template <typename T>
+static void recordTiming(const char* name, const Decoded<T>& decoded, double upload_start)
+{
+	AssetTiming timing = { name, decoded.start, decoded.end, upload_start, millisecondsSince(init_start) };
+	asset_timeline.push_back(timing);
+}
+
+static Mesh uploadMesh(const char* name, std::future<Decoded<MeshData> >& pending)
+{
+	Decoded<MeshData> mesh_data = pending.get();
+	TraceScope trace("upload mesh", name);
+	double upload_start = millisecondsSince(init_start);
+	Mesh mesh = createMesh(mesh_data.data);
+	releaseMeshData(mesh_data.data);
+	recordTiming(name, mesh_data, upload_start);
+	return mesh;
+}
+
+// also appends the mesh to the packed static scene, the separate mesh is kept for the per-mesh path
+static Mesh uploadStaticMesh(const char* name, std::future<Decoded<MeshData> >& pending, const ModelUBO& model)
+{
+	Decoded<MeshData> mesh_data = pending.get();
+	TraceScope trace("upload mesh", name);
+	double upload_start = millisecondsSince(init_start);
+	addStaticMesh(mesh_data.data, model);
+	Mesh mesh = createMesh(mesh_data.data);
+	releaseMeshData(mesh_data.data);
+	recordTiming(name, mesh_data, upload_start);
+	return mesh;
+}
+
+static void printAssetTimeline()
+{
+	std::printf("%-24s %14s %10s %10s\n", "asset", "decode [ms]", "took", "upload");
+	for (size_t i = 0; i < asset_timeline.size(); i++) {
+		const AssetTiming& t = asset_timeline[i];
+		std::printf("%-24s %6.1f-%7.1f %10.2f %10.2f\n", t.name.c_str(), t.decode_start, t.decode_end,
+			t.decode_end - t.decode_start, t.upload_end - t.upload_start);
+	}
+	std::printf("meshes ready after %.1f ms, textures %s\n", millisecondsSince(init_start),
+		texturesStreaming() ? "still streaming" : "uploaded");
+	asset_timeline.clear();
+}
 
+// one SIMULATION_STEP of keyboard movement and train rotation
+static void stepSimulation()
+{
+	previous_eye_pos = camera.eye_pos;
+	previous_train_angle = train_rotation_angle;
+
+	glm::vec3 side_dir = glm::normalize(glm::cross(camera.up_dir, camera.view_dir));
+	glm::vec3 forward_dir = glm::normalize(glm::vec3(camera.view_dir.x, 0, camera.view_dir.z));
+	float step_distance = MOVEMENT_SPEED * float(SIMULATION_STEP);
+	if (move_forward) { camera.eye_pos += forward_dir * step_distance; }
+	if (move_back)    { camera.eye_pos -= forward_dir * step_distance; }
+	if (move_left)    { camera.eye_pos += side_dir * step_distance; }
+	if (move_right)   { camera.eye_pos -= side_dir * step_distance; }
+
+	if (!TRAIN_ANGLE_SCRIPTED) { train_rotation_angle += TRAIN_ROTATION_SPEED * float(SIMULATION_STEP); }
+}
+
+// light uniforms of the forward programs, set once their link has been checked
+static void setLightUniforms()
+{
 	// point light
 	glProgramUniform3f(texture_program, 4, light_position.x, light_position.y, light_position.z); // pos
 	glProgramUniform3f(floor_program, 4, light_position.x, light_position.y, light_position.z); // pos
 	// spot light
 	glProgramUniform3f(texture_program, 5, spotlight_position.x, spotlight_position.y, spotlight_position.z); // pos
 	glProgramUniform3f(texture_program, 6, spotlight_direction.x, spotlight_direction.y, spotlight_direction.z); // dir
+	// instanced and indirect models share the texture shader lighting
+	glProgramUniform3f(instanced_program, 4, light_position.x, light_position.y, light_position.z);
+	glProgramUniform3f(instanced_program, 5, spotlight_position.x, spotlight_position.y, spotlight_position.z);
+	glProgramUniform3f(instanced_program, 6, spotlight_direction.x, spotlight_direction.y, spotlight_direction.z);
+	glProgramUniform3f(indirect_program, 4, light_position.x, light_position.y, light_position.z);
+	glProgramUniform3f(indirect_program, 5, spotlight_position.x, spotlight_position.y, spotlight_position.z);
+	glProgramUniform3f(indirect_program, 6, spotlight_direction.x, spotlight_direction.y, spotlight_direction.z);
+}
 
-	/* ====================  BUFFERS ==================== */
+void init() 
+{
+	TraceScope trace("init");
+	init_start = std::chrono::steady_clock::now();
+
+	// PNG decoding and OBJ parsing run on loader threads, GL calls stay on this one,
+	// the pool outlives init() as textures keep decoding while the first frames render
+	unsigned loader_threads = LOADER_THREADS ? LOADER_THREADS : std::max(1u, std::thread::hardware_concurrency());
+	asset_loader.reset(new ThreadPool(loader_threads));
+	ThreadPool& loader = *asset_loader;
+
+	// the driver compiles on its own threads, link results are only checked in finishPrograms()
+	if (PARALLEL_SHADER_COMPILE && GLEW_KHR_parallel_shader_compile) { glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); }
+	else if (PARALLEL_SHADER_COMPILE && GLEW_ARB_parallel_shader_compile) { glMaxShaderCompilerThreadsARB(0xFFFFFFFF); }
+
+	// train first, it is the longest job
+	std::future<Decoded<MeshData> > train_data   = loadMeshAsync(loader, "obj/train.obj");
+	std::future<Decoded<MeshData> > walls_data   = loadMeshAsync(loader, "obj/walls.obj");
+	std::future<Decoded<MeshData> > chair_data   = loadMeshAsync(loader, "obj/chair.obj");
+	std::future<Decoded<MeshData> > windows_data = loadMeshAsync(loader, "obj/windows.obj");
+	std::future<Decoded<MeshData> > balcony_data = loadMeshAsync(loader, "obj/balcony.obj");
+	std::future<Decoded<MeshData> > podium_data  = loadMeshAsync(loader, "obj/podium.obj");
+	std::future<Decoded<MeshData> > statue_data  = loadMeshAsync(loader, "obj/statue.obj");
+	std::future<Decoded<MeshData> > stand_data   = loadMeshAsync(loader, "obj/stand.obj");
+	std::future<Decoded<MeshData> > floor_data   = loadMeshAsync(loader, "obj/floor.obj");
+	std::future<Decoded<MeshData> > pillar_data  = loadMeshAsync(loader, "obj/pillar.obj");
+
+	// textures, queued behind the meshes init() waits for, the placeholder is bound until they are streamed in
+	initTextureStreaming();
+	streamTexture(&walls_texture	 , loadImageAsync(loader, "images/walls.png", true)  , "images/walls.png");
+	streamTexture(&stand_texture	 , loadImageAsync(loader, "images/stand.png", true)  , "images/stand.png");
+	streamTexture(&light_wood_texture, loadImageAsync(loader, "images/chair.png", true)  , "images/chair.png");
+	streamTexture(&dark_wood_texture , loadImageAsync(loader, "images/podium.png", true) , "images/podium.png");
+	streamTexture(&balcony_texture	 , loadImageAsync(loader, "images/balcony.png", true), "images/balcony.png");
+	streamTexture(&gold_texture	 , loadImageAsync(loader, "images/gold.png", true)   , "images/gold.png");
+
+	// programs, submitted while the loader threads work
+	double programs_start = millisecondsSince(init_start);
+	floor_program   = createProgram("shaders/default.vert", "shaders/procedural_parquet.frag");
+	texture_program = createProgram("shaders/default.vert", "shaders/texture.frag");
+	instanced_program = createProgram("shaders/instanced.vert", "shaders/texture.frag");
+	indirect_program = createProgram("shaders/indirect.vert", "shaders/indirect.frag");
+	skybox_program  = createProgram("shaders/skybox.vert" , "shaders/skybox.frag");
+	statue_program  = createProgram("shaders/default.vert", "shaders/statue.frag");
+	depth_program              = createProgram("shaders/default.vert"  , "shaders/depth.frag");
+	depth_instanced_program    = createProgram("shaders/instanced.vert", "shaders/depth.frag");
+	depth_indirect_program     = createProgram("shaders/indirect.vert" , "shaders/depth.frag");
+	overdraw_program           = createProgram("shaders/default.vert"  , "shaders/overdraw.frag");
+	overdraw_instanced_program = createProgram("shaders/instanced.vert", "shaders/overdraw.frag");
+	overdraw_indirect_program  = createProgram("shaders/indirect.vert" , "shaders/overdraw.frag");
+	gbuffer_program            = createProgram("shaders/default.vert"  , "shaders/gbuffer.frag");
+	gbuffer_floor_program      = createProgram("shaders/default.vert"  , "shaders/gbuffer_parquet.frag");
+	gbuffer_statue_program     = createProgram("shaders/default.vert"  , "shaders/gbuffer_statue.frag");
+	gbuffer_instanced_program  = createProgram("shaders/instanced.vert", "shaders/gbuffer.frag");
+	gbuffer_indirect_program   = createProgram("shaders/indirect.vert" , "shaders/gbuffer_indirect.frag");
+	clustered_program           = createProgram("shaders/default.vert"  , "shaders/texture.frag"           , clusterShaderDefines());
+	clustered_floor_program     = createProgram("shaders/default.vert"  , "shaders/procedural_parquet.frag", clusterShaderDefines());
+	clustered_instanced_program = createProgram("shaders/instanced.vert", "shaders/texture.frag"           , clusterShaderDefines());
+	clustered_indirect_program  = createProgram("shaders/indirect.vert" , "shaders/indirect.frag"          , clusterShaderDefines());
+	// the statue is unlit, its own program stands in for the clustered one
+	setProgramVariants(floor_program    , depth_program          , overdraw_program          , gbuffer_floor_program    , clustered_floor_program);
+	setProgramVariants(texture_program  , depth_program          , overdraw_program          , gbuffer_program          , clustered_program);
+	setProgramVariants(statue_program   , depth_program          , overdraw_program          , gbuffer_statue_program   , statue_program);
+	setProgramVariants(instanced_program, depth_instanced_program, overdraw_instanced_program, gbuffer_instanced_program, clustered_instanced_program);
+	setProgramVariants(indirect_program , depth_indirect_program , overdraw_indirect_program , gbuffer_indirect_program , clustered_indirect_program);
+	AssetTiming programs_timing = { "programs", 0.0, 0.0, programs_start, millisecondsSince(init_start) };
+	asset_timeline.push_back(programs_timing);
+
+	// static models in command order: opaque textured set grouped by texture, floor, windows
+	walls_mesh   = uploadStaticMesh("obj/walls.obj", walls_data, walls_model_ubo);
+	balcony_mesh = uploadStaticMesh("obj/balcony.obj", balcony_data, default_model_ubo);
+	pillar_mesh  = uploadStaticMesh("obj/pillar.obj", pillar_data, default_model_ubo);
+	podium_mesh  = uploadStaticMesh("obj/podium.obj", podium_data, default_model_ubo);
+	stand_mesh   = uploadStaticMesh("obj/stand.obj", stand_data, default_model_ubo);
+	floor_mesh   = uploadStaticMesh("obj/floor.obj", floor_data, default_model_ubo);
+	windows_mesh = uploadStaticMesh("obj/windows.obj", windows_data, default_model_ubo);
+	buildStaticScene();
+	if (GPU_FRUSTUM_CULLING && HIZ_OCCLUSION_CULLING) {
+		initHiZ();
+	}
+	static_textured_draws[STATIC_WALLS]   = staticSceneDraw(0, 1);
+	static_textured_draws[STATIC_BALCONY] = staticSceneDraw(1, 2); // balcony and pillar
+	static_textured_draws[STATIC_PODIUM]  = staticSceneDraw(3, 1);
+	static_textured_draws[STATIC_STAND]   = staticSceneDraw(4, 1);
+	static_floor_draw    = staticSceneDraw(5, 1);
+	static_windows_draw  = staticSceneDraw(6, 1);
+
+	// other models, CPU-side vertices are released right after upload
+	chair_mesh   = uploadMesh("obj/chair.obj", chair_data);
+	statue_mesh  = uploadMesh("obj/statue.obj", statue_data);
+	train_mesh	 = uploadMesh("obj/train.obj", train_data);
 
-	glCreateBuffers(1, &camera_buffer);
-    glNamedBufferStorage(camera_buffer, sizeof(CameraUBO), &camera_ubo, GL_DYNAMIC_STORAGE_BIT);
+	/* ====================  BUFFERS ==================== */
 
-	glCreateBuffers(1, &model_buffer);
-    glNamedBufferStorage(model_buffer, sizeof(ModelUBO), &default_model_ubo, GL_DYNAMIC_STORAGE_BIT);
+	// camera and model uniforms, rewritten every frame
+	initUniformRing();
+
+	// the same two lights plus the lot spotlights for deferred shading
+	initLights(glm::vec3(light_position), spotlight_position, spotlight_direction, LIGHT_COUNT);
+	initDeferred();
+	initClusters();
+
+	// chair grid, static
+	for (int i = 0; i < CHAIR_ROWS; i++) {
+		for (int j = 0; j < CHAIR_COLUMNS; j++) {
+			InstanceData chair = InstanceData();
+			chair.model_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(i * CHAIR_ROW_SPACING, 0.0f, - j * CHAIR_COLUMN_SPACING));
+			chair.shininess = 0.5f;
+			chair_instances.push_back(chair);
+		}
+	}
+	glCreateBuffers(1, &chair_instance_buffer);
+	glNamedBufferStorage(chair_instance_buffer, chair_instances.size() * sizeof(InstanceData), chair_instances.data(), 0);
+
+	// culling boxes, static objects once, the train is updated every frame
+	resizeBoxes(mesh_boxes, PACKED_MESH_COUNT);
+	setBox(mesh_boxes, MESH_FLOOR  , floor_mesh.bounds_min  , floor_mesh.bounds_max  , default_model_ubo.model_matrix);
+	setBox(mesh_boxes, MESH_PODIUM , podium_mesh.bounds_min , podium_mesh.bounds_max , default_model_ubo.model_matrix);
+	setBox(mesh_boxes, MESH_STAND  , stand_mesh.bounds_min  , stand_mesh.bounds_max  , default_model_ubo.model_matrix);
+	setBox(mesh_boxes, MESH_BALCONY, balcony_mesh.bounds_min, balcony_mesh.bounds_max, default_model_ubo.model_matrix);
+	setBox(mesh_boxes, MESH_PILLAR , pillar_mesh.bounds_min , pillar_mesh.bounds_max , default_model_ubo.model_matrix);
+	setBox(mesh_boxes, MESH_WALLS  , walls_mesh.bounds_min  , walls_mesh.bounds_max  , walls_model_ubo.model_matrix);
+	setBox(mesh_boxes, MESH_WINDOWS, windows_mesh.bounds_min, windows_mesh.bounds_max, default_model_ubo.model_matrix);
+	mesh_visible.assign(PACKED_MESH_COUNT, 1);
+
+	resizeBoxes(object_boxes, OBJECT_COUNT);
+	setBox(object_boxes, OBJECT_STATUE, statue_mesh.bounds_min , statue_mesh.bounds_max , default_model_ubo.model_matrix);
+	setBox(object_boxes, OBJECT_TRAIN , train_mesh.bounds_min  , train_mesh.bounds_max  , train_model_ubo.model_matrix);
+	object_visible.assign(OBJECT_COUNT, 1);
+
+	resizeBoxes(chair_boxes, chair_instances.size());
+	for (size_t i = 0; i < chair_instances.size(); i++) {
+		setBox(chair_boxes, i, chair_mesh.bounds_min, chair_mesh.bounds_max, chair_instances[i].model_matrix);
+	}
+	chair_visible.assign(chair_instances.size(), 1);
 
 	/* ===================== SKYBOX =================== */
 
@@ -92,15 +331,12 @@ void init()
 	glNamedBufferStorage(skybox_vbo, 8 * 3 * sizeof(float), skybox_data, 0);
 
 	// cubemap texture
-	int width, height, channels;
 	glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &skybox_texture);
 	glTextureStorage2D(skybox_texture, std::log2(1024)+1, GL_RGBA8, 1024, 1024);
 
-	// load textures
-	stbi_set_flip_vertically_on_load(false);
+	// faces are streamed like the other textures, mipmaps follow the last one
 	for (int i = 0; i < 6; i++) {
-		unsigned char* sky_plane = stbi_load( sky_tex_strings[i], &width, &height, &channels, 4);
-		glTextureSubImage3D(skybox_texture, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, sky_plane);
+		streamCubemapFace(skybox_texture, i, loadImageAsync(loader, sky_tex_strings[i], false), sky_tex_strings[i]);
 	}
 
 	// skybox vao
@@ -111,89 +347,293 @@ void init()
     glVertexArrayAttribBinding(skybox_vao, 0, 0);
 
 	// settings
-	glGenerateTextureMipmap(skybox_texture);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);	
+	glTextureParameteri(skybox_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(skybox_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(skybox_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(skybox_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(skybox_texture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);	
+
+	if (!STREAM_TEXTURES) {
+		TraceScope trace("upload textures");
+		flushTextureStreaming();
+	}
+
+	// everything above overlapped with the driver's compiler threads
+	finishPrograms();
+	setLightUniforms();
+	if (SHADER_HOT_RELOAD) { startShaderWatcher(); }
+	std::printf("programs: %d from the binary cache, %d compiled, ready after %.1f ms\n",
+		programCacheHits(), programCacheMisses(), millisecondsSince(init_start));
+
+	printAssetTimeline();
+
+	// loading time is not simulated
+	resetFrameClock();
 }
 
 void draw() 
 {
     /* ==================== UPDATE ==================== */
 
+	TraceScope trace("draw");
+
+	// textures decoded since the last frame
+	{
+		TraceScope trace("stream textures");
+		updateTextureStreaming(TEXTURE_UPLOAD_BUDGET);
+	}
+
+	// edited shaders, a replaced program starts with default uniforms
+	if (SHADER_HOT_RELOAD) {
+		TraceScope trace("reload shaders");
+		if (reloadShaders()) { setLightUniforms(); }
+	}
+
+	// fixed steps for the time since the last frame, drawn between the last two
+	FrameTiming timing = tickFrameClock();
+	for (int i = 0; i < timing.steps; i++) { stepSimulation(); }
+	glm::vec3 eye_pos = glm::mix(previous_eye_pos, camera.eye_pos, timing.alpha);
+	float train_angle = glm::mix(previous_train_angle, train_rotation_angle, timing.alpha);
+
 	// moving camera
     camera_ubo.proj_mat = glm::perspective(FOV, float(WIDTH) / float(HEIGHT), NEAR, FAR);
-    camera_ubo.view_mat = glm::lookAt(camera.eye_pos, camera.eye_pos + camera.view_dir, camera.up_dir);
-	camera_ubo.position = camera.eye_pos;
-    glNamedBufferSubData(camera_buffer, 0, sizeof(CameraUBO), &camera_ubo);
+    camera_ubo.view_mat = glm::lookAt(eye_pos, eye_pos + camera.view_dir, camera.up_dir);
+	camera_ubo.position = eye_pos;
 
 	// rotating train
-	train_rotation_angle += TRAIN_ROTATION_SPEED;
 	train_model_ubo.shininess = 1.0f; 
 	train_model_ubo.model_matrix = glm::translate(glm::mat4(1.0f), train_position)
-								 * glm::rotate(glm::mat4(1.0f), train_rotation_angle, glm::vec3(0.0f, 1.0f, 0.0f));
+								 * glm::rotate(glm::mat4(1.0f), train_angle, glm::vec3(0.0f, 1.0f, 0.0f));
 
     /* ================================================== */
 	
 	glClear(GL_COLOR_BUFFER_BIT);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1, camera_buffer);
-	glBindBufferBase(GL_UNIFORM_BUFFER, 2, model_buffer);
+	beginUniformFrame();
+	beginRenderQueue();
+	resetFrameStats();
+	frame_stats.frame_ms = timing.frame_seconds * 1000.0;
+	frame_stats.simulation_steps = timing.steps;
+	beginGpuFrame();
+	bindUniforms(1, allocateUniforms(&camera_ubo, sizeof(CameraUBO)));
+
+	// model uniforms, written once and shared by all draws using them
+	UniformAllocation default_model = allocateUniforms(&default_model_ubo, sizeof(ModelUBO));
+	UniformAllocation walls_model   = allocateUniforms(&walls_model_ubo, sizeof(ModelUBO));
+	UniformAllocation train_model   = allocateUniforms(&train_model_ubo, sizeof(ModelUBO));
 	
 	/* ==================== DRAW MODELS ==================== */
 
-	// floor, procedural texture
-	glUseProgram(floor_program);
-    glBindVertexArray(floor_vao);
-    glDrawArrays(GL_TRIANGLES, 0, floor_model.size());
-
-	// chairs
-	ModelUBO chair_ubo = { glm::mat4(1.0f), 0.5f };
-	for (int i = 0; i < 2; i++) {
-		for (int j = 0; j < 4; j++) {
-			chair_ubo.model_matrix = glm::translate(glm::mat4(1.0f), glm::vec3( i * 2.0f, 0.0f, - j * 1.5f));
-			drawModel(chair_model, chair_vao, texture_program, light_wood_texture, chair_ubo);
+	std::chrono::steady_clock::time_point submit_start = std::chrono::steady_clock::now();
+	glm::mat4 view_projection = camera_ubo.proj_mat * camera_ubo.view_mat;
+
+	// CPU culling of everything outside the GPU-culled packed scene, the packed meshes too when
+	// they are drawn one by one
+	size_t visible_chairs = chair_instances.size();
+	if (CPU_FRUSTUM_CULLING) {
+		TraceScope trace("cpu culling");
+		Frustum frustum = extractFrustum(view_projection);
+		setBox(object_boxes, OBJECT_TRAIN, train_mesh.bounds_min, train_mesh.bounds_max, train_model_ubo.model_matrix);
+		size_t visible_objects = cullBoxes(frustum, object_boxes, object_visible.data());
+		visible_chairs = cullBoxes(frustum, chair_boxes, chair_visible.data());
+		size_t tested = object_boxes.count + chair_boxes.count;
+		if (!MULTI_DRAW_ENABLED) {
+			visible_objects += cullBoxes(frustum, mesh_boxes, mesh_visible.data());
+			tested += mesh_boxes.count;
+		}
+
+		frame_stats.cpu_visible = int(visible_objects + visible_chairs);
+		frame_stats.cpu_culled = int(tested) - frame_stats.cpu_visible;
+		frame_stats.cull_ms = millisecondsSince(submit_start);
+	}
+
+	if (MULTI_DRAW_ENABLED) {
+		// walls and pillar depth for the occlusion test
+		GLuint hiz_texture = 0;
+		if (GPU_FRUSTUM_CULLING && HIZ_OCCLUSION_CULLING) {
+			GpuScope scope(GPU_PASS_OCCLUDERS);
+			beginOccluderPass();
+			glBindVertexArray(walls_mesh.vao);
+			bindUniforms(2, walls_model);
+			drawMesh(walls_mesh);
+			glBindVertexArray(pillar_mesh.vao);
+			bindUniforms(2, default_model);
+			drawMesh(pillar_mesh);
+			buildHiZ();
+			hiz_texture = hiZTexture();
+		}
+		{
+			GpuScope scope(GPU_PASS_CULLING);
+			cullStaticScene(view_projection, hiz_texture);
+		}
+
+		// textures of the opaque set, they change while they stream in
+		static_textured_draws[STATIC_WALLS].texture   = walls_texture;
+		static_textured_draws[STATIC_BALCONY].texture = balcony_texture;
+		static_textured_draws[STATIC_PODIUM].texture  = dark_wood_texture;
+		static_textured_draws[STATIC_STAND].texture   = stand_texture;
+		static_windows_draw.texture = walls_texture;
+
+		// walls, balcony and pillar, podium, stand, one call per texture
+		for (int i = 0; i < STATIC_TEXTURED_COUNT; i++) {
+			submitIndirect(PASS_OPAQUE, static_textured_draws[i], indirect_program, UniformAllocation());
+		}
+		submitIndirect(PASS_OPAQUE, static_floor_draw, floor_program, default_model);
+	}
+	else {
+		// floor, procedural texture
+		if (mesh_visible[MESH_FLOOR])   { submitModel(PASS_OPAQUE, floor_mesh, floor_program, 0, default_model); }
+
+		if (mesh_visible[MESH_PODIUM])  { submitModel(PASS_OPAQUE, podium_mesh , texture_program, dark_wood_texture, default_model); }
+		if (mesh_visible[MESH_STAND])   { submitModel(PASS_OPAQUE, stand_mesh  , texture_program, stand_texture	 , default_model); }
+		if (mesh_visible[MESH_BALCONY]) { submitModel(PASS_OPAQUE, balcony_mesh, texture_program, balcony_texture	 , default_model); }
+		if (mesh_visible[MESH_PILLAR])  { submitModel(PASS_OPAQUE, pillar_mesh , texture_program, balcony_texture	 , default_model); }
+		if (mesh_visible[MESH_WALLS])   { submitModel(PASS_OPAQUE, walls_mesh  , texture_program, walls_texture	 , walls_model); }
+	}
+
+	// chairs, whole grid in one draw, culled grids draw only the visible chairs from this frame's storage region
+	if (!CPU_FRUSTUM_CULLING) {
+		submitInstanced(PASS_OPAQUE, chair_mesh, instanced_program, light_wood_texture, chair_instance_buffer, GLsizei(chair_instances.size()));
+	}
+	else if (visible_chairs) {
+		void* data;
+		UniformAllocation chairs = reserveStorage(visible_chairs * sizeof(InstanceData), &data);
+		InstanceData* visible = static_cast<InstanceData*>(data);
+		for (size_t i = 0; i < chair_instances.size(); i++) {
+			if (chair_visible[i]) { *visible++ = chair_instances[i]; }
 		}
-	} 
+		submitInstancedStorage(PASS_OPAQUE, chair_mesh, instanced_program, light_wood_texture, chairs, GLsizei(visible_chairs));
+	}
 
-	drawModel(podium_model , podium_vao , texture_program, dark_wood_texture , default_model_ubo);
-	drawModel(stand_model  , stand_vao	 , texture_program, stand_texture	  , default_model_ubo);
-	drawModel(train_model  , train_vao	 , texture_program, gold_texture, train_model_ubo);
-	drawModel(balcony_model, balcony_vao, texture_program, balcony_texture	  , default_model_ubo);
-	drawModel(pillar_model , pillar_vao , texture_program, balcony_texture	  , default_model_ubo);
-	drawModel(walls_model  , walls_vao	 , texture_program, walls_texture	  , walls_model_ubo);
-	drawModel(statue_model , statue_vao , statue_program , skybox_texture	  , default_model_ubo);
+	if (object_visible[OBJECT_TRAIN])  { submitModel(PASS_OPAQUE, train_mesh , texture_program, gold_texture  , train_model); }
+	if (object_visible[OBJECT_STATUE]) { submitModel(PASS_OPAQUE, statue_mesh, statue_program , skybox_texture, default_model); }
+
+	// windows rendered last -> blending; the walls are opaque and already in the depth buffer,
+	// a second walls draw here would be rejected by the depth test pixel for pixel
+	if (MULTI_DRAW_ENABLED) {
+		submitIndirect(PASS_BLENDED, static_windows_draw, texture_program, default_model);
+	}
+	else if (mesh_visible[MESH_WINDOWS]) {
+		submitModel(PASS_BLENDED, windows_mesh, texture_program, walls_texture, default_model);
+	}
+
+	{
+		TraceScope trace("sort render queue");
+		sortRenderQueue();
+	}
+
+	// deferred: G-buffer, then every light shades the pixels inside its volume, the forward
+	// pre-pass and overdraw view do not apply
+	bool deferred = deferredShading();
+	bool prepass = DEPTH_PREPASS_ENABLED && !deferred;
+	bool overdraw_view = OVERDRAW_VIEW_ENABLED && !deferred;
+
+	// clustered: light lists for this view, used by the forward passes, in deferred mode by the windows
+	bool clustered = clusteredLighting() && !overdraw_view;
+	if (clustered) {
+		GpuScope scope(GPU_PASS_CLUSTERS);
+		buildClusters(camera_ubo.view_mat, camera_ubo.proj_mat);
+	}
+	if (deferred) {
+		{
+			GpuScope scope(GPU_PASS_GBUFFER);
+			beginGBufferPass();
+			executeRenderPass(PASS_OPAQUE, RENDER_GBUFFER);
+			frame_stats.submit_ms = millisecondsSince(submit_start);
+		}
+		GpuScope scope(GPU_PASS_LIGHTING);
+		executeLightingPass();
+		invalidateRenderState();
+	}
+
+	// depth only, then every pixel is shaded once by the fragment that wrote its depth
+	if (prepass) {
+		GpuScope scope(GPU_PASS_DEPTH);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		executeRenderPass(PASS_OPAQUE, RENDER_DEPTH_ONLY);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+
+	// the overdraw view counts shaded fragments with additive blending
+	RenderMode shading_mode = overdraw_view ? RENDER_OVERDRAW : clustered ? RENDER_CLUSTERED : RENDER_SHADED;
+	if (overdraw_view) { glBlendFunc(GL_ONE, GL_ONE); }
+
+	if (!deferred) {
+		GpuScope scope(GPU_PASS_OPAQUE);
+		beginShadedSamplesQuery();
+		executeRenderPass(PASS_OPAQUE, shading_mode);
+		endShadedSamplesQuery();
+		frame_stats.submit_ms = millisecondsSince(submit_start);
+	}
+
+	if (prepass) {
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+
+	// skybox, left out of the overdraw view
+	if (!overdraw_view) {
+		GpuScope scope(GPU_PASS_SKYBOX);
+		glDepthFunc(GL_LEQUAL); // overwrite if depth = 1 -> empty pixel
+		glUseProgram(skybox_program);
+		glBindVertexArray(skybox_vao);
+		glBindTextureUnit(0, skybox_texture);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, skybox_indeces);
+		glDepthFunc(GL_LESS); 	// set depth function back
+		invalidateRenderState();
+	}
+
+	{
+		GpuScope scope(GPU_PASS_BLENDED);
+		executeRenderPass(PASS_BLENDED, shading_mode);
+	}
+	if (overdraw_view) { glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); }
 
-	// skybox
-	glDepthFunc(GL_LEQUAL); // overwrite if depth = 1 -> empty pixel
-	glUseProgram(skybox_program);
-    glBindVertexArray(skybox_vao);
-	glBindTextureUnit(0, skybox_texture);
-	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, skybox_indeces);
-	glDepthFunc(GL_LESS); 	// set depth function back
+	if (deferred) { endDeferredFrame(); }
 
-	// walls and windows rendered last -> blending
-	drawModel(walls_model, walls_vao, texture_program, walls_texture, walls_model_ubo);
-	drawModel(windows_model, windows_vao, texture_program, walls_texture, default_model_ubo);
+	endGpuFrame();
+	endUniformFrame();
+	logFrameStats();
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    glm::vec3 side_dir = glm::normalize(glm::cross(camera.up_dir, camera.view_dir));
-	glm::vec3 forward_dir = glm::normalize(glm::vec3(camera.view_dir.x, 0, camera.view_dir.z));
-
-    if (key == GLFW_KEY_W) {
-        camera.eye_pos += forward_dir * MOVEMENT_SPEED;
+    // movement is applied by the simulation steps while a key is down, repeats change nothing
+    if (action != GLFW_REPEAT) {
+        bool held = action == GLFW_PRESS;
+        if (key == GLFW_KEY_W) { move_forward = held; }
+        if (key == GLFW_KEY_S) { move_back = held; }
+        if (key == GLFW_KEY_A) { move_left = held; }
+        if (key == GLFW_KEY_D) { move_right = held; }
+    }
+    if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+        VSYNC_ENABLED = !VSYNC_ENABLED;
+        glfwSwapInterval(VSYNC_ENABLED ? 1 : 0);
+        std::printf("vsync %s\n", VSYNC_ENABLED ? "on" : "off, uncapped");
+    }
+    if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+        MULTI_DRAW_ENABLED = !MULTI_DRAW_ENABLED;
+        std::printf("multi-draw indirect %s\n", MULTI_DRAW_ENABLED ? "on" : "off");
     }
-    if (key == GLFW_KEY_S) {
-        camera.eye_pos -= forward_dir * MOVEMENT_SPEED;
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        DEPTH_PREPASS_ENABLED = !DEPTH_PREPASS_ENABLED;
+        std::printf("depth pre-pass %s\n", DEPTH_PREPASS_ENABLED ? "on" : "off");
     }
-    if (key == GLFW_KEY_A) {
-        camera.eye_pos += side_dir * MOVEMENT_SPEED;
+    if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+        OVERDRAW_VIEW_ENABLED = !OVERDRAW_VIEW_ENABLED;
+        std::printf("overdraw view %s\n", OVERDRAW_VIEW_ENABLED ? "on" : "off");
     }
-    if (key == GLFW_KEY_D) {
-        camera.eye_pos -= side_dir * MOVEMENT_SPEED;
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        setDeferredShading(!deferredShading());
+        std::printf("deferred shading %s\n", deferredShading() ? "on" : "off");
+    }
+    if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        setClusteredLighting(!clusteredLighting());
+        std::printf("clustered lighting %s\n", clusteredLighting() ? "on" : "off");
+    }
+    if (key == GLFW_KEY_T && action == GLFW_PRESS && CPU_TRACE) {
+        writeTrace(TRACE_FILE);
     }
     
 }
@@ -227,13 +667,58 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
     camera.up_dir = glm::mat3(vertical_rotation * horizontal_rotation) * camera.up_dir;
 }
 
-void drawModel(std::vector<Vertex> model, GLuint vao, GLuint program, GLuint texture, ModelUBO ubo) 
+void setCamera(const glm::vec3& eye_pos, const glm::vec3& view_dir)
+{
+    camera.eye_pos = eye_pos;
+    camera.view_dir = glm::normalize(view_dir);
+    camera.up_dir = glm::vec3(0.0f, 1.0f, 0.0f);
+    previous_eye_pos = eye_pos;
+}
+
+void setCamera(const glm::vec3& eye_pos, const glm::vec3& view_dir, const glm::vec3& up_dir)
+{
+    camera.eye_pos = eye_pos;
+    camera.view_dir = glm::normalize(view_dir);
+    camera.up_dir = glm::normalize(up_dir);
+    previous_eye_pos = eye_pos;
+}
+
+void setTrainRotation(float angle)
+{
+    train_rotation_angle = angle;
+    previous_train_angle = angle;
+    TRAIN_ANGLE_SCRIPTED = true;
+}
+
+void setSceneFramebuffer(GLuint framebuffer)
+{
+    scene_framebuffer = framebuffer;
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+GLuint sceneFramebuffer()
 {
-	glUseProgram(program);
-    glBindVertexArray(vao);
-	glBindTextureUnit(0, texture);
-	glNamedBufferSubData(model_buffer, 0, sizeof(ModelUBO), &ubo);
-    glDrawArrays(GL_TRIANGLES, 0, model.size());
+    return scene_framebuffer;
+}
+
+void drawMesh(const Mesh& mesh)
+{
+	if (mesh.ebo) {
+		glDrawElements(GL_TRIANGLES, mesh.index_count, GL_UNSIGNED_INT, NULL);
+	}
+	else {
+		glDrawArrays(GL_TRIANGLES, 0, mesh.vertex_count);
+	}
+}
+
+void drawMeshInstanced(const Mesh& mesh, GLsizei instance_count)
+{
+	if (mesh.ebo) {
+		glDrawElementsInstanced(GL_TRIANGLES, mesh.index_count, GL_UNSIGNED_INT, NULL, instance_count);
+	}
+	else {
+		glDrawArraysInstanced(GL_TRIANGLES, 0, mesh.vertex_count, instance_count);
+	}
 }
 
 std::string getFileContent(const char* filename)
@@ -253,56 +738,231 @@ std::string getFileContent(const char* filename)
 	throw(errno);
 }
 
-GLuint createShader(const char* filename, GLenum type) 
+std::vector<std::string> listFiles(const char* directory, const char* extension)
+{
+	std::vector<std::string> files;
+	DIR* dir = opendir(directory);
+	if (!dir) { return files; }
+
+	std::string suffix = extension;
+	while (dirent* entry = readdir(dir)) {
+		std::string name = entry->d_name;
+		if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+			files.push_back(std::string(directory) + "/" + name);
+		}
+	}
+	closedir(dir);
+
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+std::string jsonEscape(const char* text)
+{
+	std::string escaped;
+	for (const char* c = text; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			escaped += '\\';
+			escaped += *c;
+		}
+		else if ((unsigned char)*c < 0x20) {
+			char code[8];
+			std::snprintf(code, sizeof(code), "\\u%04x", *c);
+			escaped += code;
+		}
+		else {
+			escaped += *c;
+		}
+	}
+	return escaped;
+}
+
+bool usesLightingShader(const char* filename, const char* defines)
+{
+	size_t length = strlen(filename);
+	return strstr(defines, LIGHTING_DEFINE) && length > 5 && strcmp(filename + length - 5, ".frag") == 0;
+}
+
+std::string shaderSource(const char* filename, const char* defines)
 {
 	std::string shader_source = getFileContent(filename);
-	const char* shader_string = shader_source.c_str();
+	if (*defines) {
+		std::string prelude = defines;
+		if (usesLightingShader(filename, defines)) { prelude += getFileContent(LIGHTING_SHADER); }
+
+		// #line keeps the compiler's line numbers matching the file
+		size_t version_end = shader_source.find('\n') + 1;
+		shader_source.insert(version_end, prelude + "#line 2\n");
+	}
+	return shader_source;
+}
+
+bool checkStatus(GLuint ID, GLenum status, const char* name)
+{
+	bool program = status == GL_LINK_STATUS;
+	GLint success = GL_FALSE, log_length = 0;
+	if (program) {
+		glGetProgramiv(ID, status, &success);
+		glGetProgramiv(ID, GL_INFO_LOG_LENGTH, &log_length);
+	}
+	else {
+		glGetShaderiv(ID, status, &success);
+		glGetShaderiv(ID, GL_INFO_LOG_LENGTH, &log_length);
+	}
+	if (success) { return true; }
+
+	std::string log(std::max(log_length, 1), '\0');
+	if (program) { glGetProgramInfoLog(ID, log_length, NULL, &log[0]); }
+	else         { glGetShaderInfoLog(ID, log_length, NULL, &log[0]); }
+	std::cout << name << (program ? ": link failed\n" : ": compilation failed\n") << log.c_str() << std::endl;
+	return false;
+}
+
+static GLuint compileShader(const std::string& source, GLenum type, const char* filename)
+{
+	const char* shader_string = source.c_str();
 	GLuint ID = glCreateShader(type);
 	glShaderSource(ID, 1, &shader_string, NULL);
+	glCompileShader(ID);
+	if (!checkStatus(ID, GL_COMPILE_STATUS, filename)) {
+		glDeleteShader(ID);
+		throw "ERROR::SHADER::Compilation failed.";
+	}
 	return ID;
-	
 }
 
-GLuint createProgram(const char* vert_name, const char* frag_name) 
+GLuint createShader(const char* filename, GLenum type, const char* defines) 
 {
-    
-	GLuint vertex_ID = createShader(vert_name, GL_VERTEX_SHADER);
-	GLuint fragment_ID = createShader(frag_name, GL_FRAGMENT_SHADER);
+	return compileShader(shaderSource(filename, defines), type, filename);
+}
 
-	GLuint program_ID = glCreateProgram();
+// linked but not yet checked, finishPrograms() queries the status once the driver is done
+struct PendingProgram {
+	GLuint program;
+	GLuint shaders[2];
+	std::string names[2];
+	int shader_count;
+	uint64_t key; // program cache key
+};
+static std::vector<PendingProgram> pending_programs;
+
+static void finishProgram(const PendingProgram& pending)
+{
+	bool compiled = true;
+	for (int i = 0; i < pending.shader_count; i++) {
+		compiled = checkStatus(pending.shaders[i], GL_COMPILE_STATUS, pending.names[i].c_str()) && compiled;
+		glDetachShader(pending.program, pending.shaders[i]);
+		glDeleteShader(pending.shaders[i]);
+	}
+	if (!compiled) {
+		glDeleteProgram(pending.program);
+		throw "ERROR::SHADER::Compilation failed.";
+	}
+	if (!checkStatus(pending.program, GL_LINK_STATUS, pending.names[pending.shader_count - 1].c_str())) {
+		glDeleteProgram(pending.program);
+		throw "ERROR::SHADER::Link failed.";
+	}
 
-    
-    glCompileShader(vertex_ID);
-	glCompileShader(fragment_ID);
+	if (USE_PROGRAM_CACHE) { saveProgramBinary(pending.program, pending.key); }
+}
 
-	glAttachShader(program_ID, vertex_ID);
-	glAttachShader(program_ID, fragment_ID);
+void finishPrograms()
+{
+	TraceScope trace("finish programs");
+	// programs the driver has finished first, then block on the rest in submission order
+	if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile) {
+		for (size_t i = 0; i < pending_programs.size(); i++) {
+			GLint done = GL_FALSE;
+			glGetProgramiv(pending_programs[i].program, GL_COMPLETION_STATUS_KHR, &done);
+			if (done) {
+				finishProgram(pending_programs[i]);
+				pending_programs.erase(pending_programs.begin() + i--);
+			}
+		}
+	}
+	for (size_t i = 0; i < pending_programs.size(); i++) {
+		finishProgram(pending_programs[i]);
+	}
+	pending_programs.clear();
+}
 
-	glLinkProgram(program_ID); 
+// compiles and links the stages without waiting, or loads the binary cached for the same sources and driver
+static GLuint linkProgram(const char* const* names, const GLenum* types, int count, const char* defines)
+{
+	TraceScope trace("submit program", names[count - 1]);
+	std::string sources[2];
+	for (int i = 0; i < count; i++) {
+		sources[i] = shaderSource(names[i], defines);
+	}
 
-	glDeleteShader(vertex_ID);
-	glDeleteShader(fragment_ID);
+	GLuint program_ID = glCreateProgram();
+	if (SHADER_HOT_RELOAD) { registerProgram(program_ID, names, types, count, defines); }
+	uint64_t key = 0;
+	if (USE_PROGRAM_CACHE) {
+		key = programCacheKey(sources, types, count);
+		if (loadProgramBinary(program_ID, key)) { return program_ID; }
+	}
 
+	PendingProgram pending;
+	pending.program = program_ID;
+	pending.shader_count = count;
+	pending.key = key;
+	for (int i = 0; i < count; i++) {
+		const char* shader_string = sources[i].c_str();
+		pending.shaders[i] = glCreateShader(types[i]);
+		pending.names[i] = names[i];
+		glShaderSource(pending.shaders[i], 1, &shader_string, NULL);
+		glCompileShader(pending.shaders[i]);
+		glAttachShader(program_ID, pending.shaders[i]);
+	}
+
+	glProgramParameteri(program_ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program_ID);
+	pending_programs.push_back(pending);
+
+	if (!PARALLEL_SHADER_COMPILE) { finishPrograms(); }
 	return program_ID;
 }
 
-GLuint createObjectVBO(std::vector<Vertex> model)
+GLuint createProgram(const char* vert_name, const char* frag_name, const char* defines) 
+{
+	const char* names[2] = { vert_name, frag_name };
+	const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	return linkProgram(names, types, 2, defines);
+}
+
+GLuint createComputeProgram(const char* comp_name, const char* defines)
 {
-	// data pointer
-	Vertex* model_data = model.data();
+	const GLenum type = GL_COMPUTE_SHADER;
+	return linkProgram(&comp_name, &type, 1, defines);
+}
 
+GLuint createObjectVBO(const Vertex* vertices, GLsizei vertex_count)
+{
 	// create buffer in GPU
 	GLuint vbo;	
 	glCreateBuffers(1, &vbo);
-    glNamedBufferStorage(vbo, model.size() * sizeof(Vertex), model_data, 0);
+    glNamedBufferStorage(vbo, vertex_count * sizeof(Vertex), vertices, 0);
 
 	return vbo;
 }
 
-GLuint createObjectVAO(GLuint data_vbo)
+GLuint createObjectEBO(const GLuint* indices, GLsizei index_count)
+{
+	GLuint ebo;
+	glCreateBuffers(1, &ebo);
+	glNamedBufferStorage(ebo, index_count * sizeof(GLuint), indices, 0);
+
+	return ebo;
+}
+
+GLuint createObjectVAO(GLuint data_vbo, GLuint index_ebo)
 {
 	GLuint vao;
 	glCreateVertexArrays(1, &vao);
+	if (index_ebo) {
+		glVertexArrayElementBuffer(vao, index_ebo);
+	}
     glVertexArrayVertexBuffer(vao, 0, data_vbo, 0, sizeof(Vertex));
     glVertexArrayVertexBuffer(vao, 1, data_vbo, 0, sizeof(Vertex));
     glVertexArrayVertexBuffer(vao, 2, data_vbo, 0, sizeof(Vertex));
@@ -323,144 +983,308 @@ GLuint createObjectVAO(GLuint data_vbo)
 	return vao;
 }
 
-GLuint createTexture(const char* file_name) 
+Mesh createMesh(const MeshData& data)
 {
-	GLuint texture;
-	int width, height, channels;
-	stbi_set_flip_vertically_on_load(true);
-	unsigned char* texture_data = stbi_load(file_name, &width, &height, &channels, 4);
+	Mesh mesh;
+	mesh.vbo = createObjectVBO(data.vertices(), data.vertex_count);
+	mesh.ebo = data.index_count ? createObjectEBO(data.indices(), data.index_count) : 0;
+	mesh.vao = createObjectVAO(mesh.vbo, mesh.ebo);
+	mesh.vertex_count = data.vertex_count;
+	mesh.index_count = data.index_count;
+	mesh.bounds_min = data.bounds_min;
+	mesh.bounds_max = data.bounds_max;
+	return mesh;
+}
 
+ImageData loadImage(const char* file_name, bool flip)
+{
+	// per-thread flag, images are decoded on loader threads
+	ImageData image;
+	int channels;
+	stbi_set_flip_vertically_on_load_thread(flip);
+	image.pixels = stbi_load(file_name, &image.width, &image.height, &channels, 4);
+	if (!image.pixels)
+	{
+		throw "ERROR::IMAGELOADER::Could not load image.";
+	}
+	return image;
+}
+
+void freeImage(ImageData& image)
+{
+	stbi_image_free(image.pixels);
+	image.pixels = NULL;
+}
+
+GLuint createTexture(const ImageData& image)
+{
+	GLuint texture;
 	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
-	glTextureStorage2D(texture, std::log2(width), GL_RGBA8, width, height);
+	glTextureStorage2D(texture, std::log2(image.width), GL_RGBA8, image.width, image.height);
 
-	glTextureSubImage2D(texture, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, texture_data);
+	glTextureSubImage2D(texture, 0, 0, 0, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
 	glGenerateTextureMipmap(texture);
     glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	stbi_image_free(texture_data);
 
 	return texture;
 }
 
-std::vector<Vertex> loadOBJFile(const char* file_name)
+GLuint createTexture(const char* file_name) 
 {
-	//Vertex portions
-	std::vector<glm::fvec3> vertex_positions;
-	std::vector<glm::fvec2> vertex_texcoords;
-	std::vector<glm::fvec3> vertex_normals;
+	ImageData image = loadImage(file_name, true);
+	GLuint texture = createTexture(image);
+	freeImage(image);
 
-	//Face vectors
-	std::vector<GLint> vertex_position_indicies;
-	std::vector<GLint> vertex_texcoord_indicies;
-	std::vector<GLint> vertex_normal_indicies;
+	return texture;
+}
 
-	//Vertex array
-	std::vector<Vertex> vertices;
+/* ==================== OBJ PARSER ==================== */
 
-	std::stringstream ss;
-	std::ifstream in_file(file_name);
-	std::string line = "";
-	std::string prefix = "";
-	glm::vec3 temp_vec3;
-	glm::vec2 temp_vec2;
-	GLint temp_glint = 0;
+static inline const char* skipBlanks(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) { p++; }
+	return p;
+}
 
-	//File open error check
-	if (!in_file.is_open())
-	{
-		throw "ERROR::OBJLOADER::Could not open file.";
+static inline const char* skipLine(const char* p, const char* end)
+{
+	while (p < end && *p != '\n') { p++; }
+	return p < end ? p + 1 : end;
+}
+
+static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// decimal float scanner, same accepted syntax as from_chars (no hex, no inf/nan)
+static const char* parseFloat(const char* p, const char* end, float& out)
+{
+	static const double POW10[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); p++; }
+
+	// up to 19 significant digits fit into the mantissa, the rest only shifts the exponent
+	unsigned long long mantissa = 0;
+	int digits = 0, exponent = 0;
+	for (; p < end && isDigit(*p); p++) {
+		if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; }
+		else { exponent++; }
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && isDigit(*p); p++) {
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; exponent--; }
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool negative_exp = false;
+		if (p < end && (*p == '-' || *p == '+')) { negative_exp = (*p == '-'); p++; }
+		int e = 0;
+		for (; p < end && isDigit(*p); p++) { if (e < 10000) e = e * 10 + (*p - '0'); }
+		exponent += negative_exp ? -e : e;
 	}
 
-	//Read one line at a time
-	while (std::getline(in_file, line))
-	{
-		//Get the prefix of the line
-		ss.clear();
-		ss.str(line);
-		ss >> prefix;
+	double value = double(mantissa);
+	if (exponent < 0) {
+		value = (exponent >= -22) ? value / POW10[-exponent] : value * std::pow(10.0, exponent);
+	}
+	else if (exponent > 0) {
+		value = (exponent <= 22) ? value * POW10[exponent] : value * std::pow(10.0, exponent);
+	}
+	out = float(negative ? -value : value);
+	return p;
+}
 
-		if (prefix == "#")
-		{
+static inline const char* parseInt(const char* p, const char* end, int& out)
+{
+	bool negative = false;
+	if (p < end && *p == '-') { negative = true; p++; }
+	int value = 0;
+	for (; p < end && isDigit(*p); p++) { value = value * 10 + (*p - '0'); }
+	out = negative ? -value : value;
+	return p;
+}
 
-		}
-		else if (prefix == "o")
-		{
+// OBJ indices are 1-based, negative ones are relative to the end of the list
+static inline int resolveIndex(int index, size_t count)
+{
+	return index < 0 ? int(count) + index : index - 1;
+}
 
-		}
-		else if (prefix == "s")
-		{
+// face corner as resolved position/uv/normal indices, -1 when missing
+struct CornerKey {
+	int position, texcoord, normal;
+	bool operator==(const CornerKey& other) const {
+		return position == other.position && texcoord == other.texcoord && normal == other.normal;
+	}
+};
+
+struct CornerKeyHash {
+	size_t operator()(const CornerKey& key) const {
+		uint64_t hash = uint64_t(uint32_t(key.position)) * 0x9E3779B97F4A7C15ULL;
+		hash ^= (uint64_t(uint32_t(key.texcoord)) + (hash << 6) + (hash >> 2)) * 0xC2B2AE3D27D4EB4FULL;
+		hash ^= (uint64_t(uint32_t(key.normal)) + (hash << 6) + (hash >> 2)) * 0x165667B19E3779F9ULL;
+		return size_t(hash ^ (hash >> 29));
+	}
+};
 
-		}
-		else if (prefix == "use_mtl")
-		{
+MeshData parseOBJ(const char* data, size_t size)
+{
+	//Vertex portions
+	std::vector<glm::fvec3> vertex_positions;
+	std::vector<glm::fvec2> vertex_texcoords;
+	std::vector<glm::fvec3> vertex_normals;
 
-		}
-		else if (prefix == "v") //Vertex position
+	//Indexed vertex array
+	MeshData mesh;
+	std::vector<Vertex>& vertices = mesh.vertex_storage;
+	std::vector<GLuint>& indices = mesh.index_storage;
+	std::unordered_map<CornerKey, GLuint, CornerKeyHash> unique_vertices;
+
+	// rough guess from the file size so that big meshes do not reallocate too often
+	vertex_positions.reserve(size / 128);
+	vertex_texcoords.reserve(size / 128);
+	vertex_normals.reserve(size / 128);
+	vertices.reserve(size / 96);
+	indices.reserve(size / 32);
+	unique_vertices.reserve(size / 96);
+
+	const char* p = data;
+	const char* end = data + size;
+
+	// face corners of the current polygon, triangulated as a fan
+	GLuint first = 0, previous = 0;
+
+	while (p < end)
+	{
+		p = skipBlanks(p, end);
+		if (p >= end) { break; }
+
+		if (p[0] == 'v' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')) //Vertex position
 		{
-			ss >> temp_vec3.x >> temp_vec3.y >> temp_vec3.z;
-			vertex_positions.push_back(temp_vec3);
+			glm::vec3 position;
+			p = parseFloat(skipBlanks(p + 1, end), end, position.x);
+			p = parseFloat(skipBlanks(p, end), end, position.y);
+			p = parseFloat(skipBlanks(p, end), end, position.z);
+			vertex_positions.push_back(position);
 		}
-		else if (prefix == "vt")
+		else if (p[0] == 'v' && p + 2 < end && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
 		{
-			ss >> temp_vec2.x >> temp_vec2.y;
-			vertex_texcoords.push_back(temp_vec2);
+			glm::vec2 uv;
+			p = parseFloat(skipBlanks(p + 2, end), end, uv.x);
+			p = parseFloat(skipBlanks(p, end), end, uv.y);
+			vertex_texcoords.push_back(uv);
 		}
-		else if (prefix == "vn")
+		else if (p[0] == 'v' && p + 2 < end && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
 		{
-			ss >> temp_vec3.x >> temp_vec3.y >> temp_vec3.z;
-			vertex_normals.push_back(temp_vec3);
+			glm::vec3 normal;
+			p = parseFloat(skipBlanks(p + 2, end), end, normal.x);
+			p = parseFloat(skipBlanks(p, end), end, normal.y);
+			p = parseFloat(skipBlanks(p, end), end, normal.z);
+			vertex_normals.push_back(normal);
 		}
-		else if (prefix == "f")
+		else if (p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t'))
 		{
-			int counter = 0;
-			while (ss >> temp_glint)
+			p = skipBlanks(p + 1, end);
+			int corner = 0;
+			while (p < end && (isDigit(*p) || *p == '-'))
 			{
-				//Pushing indices into correct arrays
-				if (counter == 0)
-					vertex_position_indicies.push_back(temp_glint);
-				else if (counter == 1)
-					vertex_texcoord_indicies.push_back(temp_glint);
-				else if (counter == 2)
-					vertex_normal_indicies.push_back(temp_glint);
-
-				//Handling characters
-				if (ss.peek() == '/')
-				{
-					++counter;
-					ss.ignore(1, '/');
+				// v, v/vt, v//vn or v/vt/vn
+				int position_index = 0, texcoord_index = 0, normal_index = 0;
+				p = parseInt(p, end, position_index);
+				if (p < end && *p == '/') {
+					p++;
+					if (p < end && *p != '/') { p = parseInt(p, end, texcoord_index); }
+					if (p < end && *p == '/') { p = parseInt(p + 1, end, normal_index); }
+				}
+				p = skipBlanks(p, end);
+
+				CornerKey key;
+				key.position = resolveIndex(position_index, vertex_positions.size());
+				if (key.position < 0 || size_t(key.position) >= vertex_positions.size()) {
+					throw "ERROR::OBJLOADER::Face index out of range.";
 				}
-				else if (ss.peek() == ' ')
-				{
-					++counter;
-					ss.ignore(1, ' ');
+				key.texcoord = resolveIndex(texcoord_index, vertex_texcoords.size());
+				if (texcoord_index == 0 || key.texcoord < 0 || size_t(key.texcoord) >= vertex_texcoords.size()) {
+					key.texcoord = -1;
 				}
+				key.normal = resolveIndex(normal_index, vertex_normals.size());
+				if (normal_index == 0 || key.normal < 0 || size_t(key.normal) >= vertex_normals.size()) {
+					key.normal = -1;
+				}
+
+				// identical corners share one vertex
+				std::pair<std::unordered_map<CornerKey, GLuint, CornerKeyHash>::iterator, bool> inserted =
+					unique_vertices.insert(std::make_pair(key, GLuint(vertices.size())));
+				if (inserted.second) {
+					Vertex vertex = Vertex();
+					vertex.position = vertex_positions[key.position];
+					if (key.texcoord >= 0) { vertex.uv = vertex_texcoords[key.texcoord]; }
+					if (key.normal >= 0) { vertex.normal = vertex_normals[key.normal]; }
+					vertices.push_back(vertex);
+				}
+				GLuint vertex_index = inserted.first->second;
 
-				//Reset the counter
-				if (counter > 2)
-					counter = 0;
+				if (corner == 0) { first = vertex_index; }
+				else if (corner >= 2) {
+					indices.push_back(first);
+					indices.push_back(previous);
+					indices.push_back(vertex_index);
+				}
+				previous = vertex_index;
+				corner++;
 			}
 		}
-		else
-		{
+		// comments, o, s, l, usemtl... are skipped
 
-		}
+		p = skipLine(p, end);
 	}
 
-	//Build final vertex array (mesh)
-	vertices.resize(vertex_position_indicies.size(), Vertex());
+	mesh.vertex_count = GLsizei(vertices.size());
+	mesh.index_count = GLsizei(indices.size());
+	computeBounds(vertices.data(), vertices.size(), mesh.bounds_min, mesh.bounds_max);
+	return mesh;
+}
 
-	//Load in all indices
-	for (size_t i = 0; i < vertices.size(); ++i)
+MeshData loadOBJFile(const char* file_name)
+{
+	TraceScope trace("parse OBJ", file_name);
+	//File open error check
+	std::FILE* file = std::fopen(file_name, "rb");
+	if (!file)
 	{
-		vertices[i].position = vertex_positions[vertex_position_indicies[i] - 1];
-		vertices[i].uv = vertex_texcoords[vertex_texcoord_indicies[i] - 1];
-		vertices[i].normal = vertex_normals[vertex_normal_indicies[i] - 1];
+		throw "ERROR::OBJLOADER::Could not open file.";
 	}
 
-	//DEBUG
-	std::cout << "Nr of vertices: " << vertices.size() << "\n";
+	// whole file in one read, parsed in place
+	std::fseek(file, 0, SEEK_END);
+	long size = std::ftell(file);
+	std::fseek(file, 0, SEEK_SET);
+	std::vector<char> content(size > 0 ? size : 0);
+	size_t read = content.empty() ? 0 : std::fread(&content[0], 1, content.size(), file);
+	std::fclose(file);
+
+	MeshData mesh = parseOBJ(content.data(), read);
+
+	//DEBUG, unique vertices against one vertex per face corner, one write as loader threads share cout
+	std::ostringstream log;
+	log << "Nr of vertices: " << mesh.vertex_count << " unique of " << mesh.index_count << " corners ("
+	    << (mesh.vertex_count ? float(mesh.index_count) / float(mesh.vertex_count) : 0.0f) << "x reduction)\n";
 
 	//Loaded success
-	std::cout << "OBJ file loaded!" << "\n";
-	return vertices;
-}
\ No newline at end of file
+	log << file_name << " loaded!" << "\n";
+	std::cout << log.str();
+	return mesh;
+}
+
+void computeBounds(const Vertex* vertices, size_t count, glm::vec3& bounds_min, glm::vec3& bounds_max)
+{
+	bounds_min = bounds_max = count ? vertices[0].position : glm::vec3(0.0f);
+	for (size_t i = 1; i < count; i++) {
+		bounds_min = glm::min(bounds_min, vertices[i].position);
+		bounds_max = glm::max(bounds_max, vertices[i].position);
+	}
+}
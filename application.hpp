@@ -1,8 +1,11 @@
+#pragma once
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <cstdio>
+#include <cmath>
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/ext.hpp>
@@ -10,17 +13,101 @@
 
 /* ==================== SETTINGS ==================== */
 
+// mesh cache, binary copies of obj/*.obj
+const bool  USE_MESH_CACHE = true;
+const char* const MESH_CACHE_DIR = "cache";
+// program binaries from glGetProgramBinary, keyed by source and driver
+const bool  USE_PROGRAM_CACHE = true;
+const char* const PROGRAM_CACHE_DIR = "cache";
+// programs compile on driver threads (GL_KHR_parallel_shader_compile when available) while init()
+// goes on, false checks every program right after its link
+const bool  PARALLEL_SHADER_COMPILE = true;
+// programs are rebuilt when their files in shaders/ change, a failed compile keeps the old program
+const bool  SHADER_HOT_RELOAD = true;
+// light math shared by the clustered forward shaders and the deferred light pass
+const char* const LIGHTING_SHADER = "shaders/cluster_lighting.glsl";
+const char* const LIGHTING_DEFINE = "#define SHARED_LIGHTING\n";
+// mesh optimization, vertex cache size used for triangle ordering and ACMR/ATVR statistics
+const bool  OPTIMIZE_MESHES = true;
+const int   VERTEX_CACHE_SIZE = 16;
+
+// asset loading, 0 = one loader thread per hardware thread
+const unsigned LOADER_THREADS = 0;
+
+// texture streaming through persistently mapped PBOs, STREAM_TEXTURES = false uploads everything in init()
+const bool   STREAM_TEXTURES = true;
+const int    TEXTURE_UPLOAD_SLOTS = 4;
+const size_t TEXTURE_UPLOAD_SLOT_SIZE = 4 * 1024 * 1024;
+const size_t TEXTURE_UPLOAD_BUDGET = 8 * 1024 * 1024; // per frame
+
+// per-frame uniform ring buffer, frames in flight and bytes per frame
+const int        UNIFORM_RING_FRAMES = 3;
+const GLsizeiptr UNIFORM_RING_FRAME_SIZE = 64 * 1024;
+// per-frame shader storage for CPU-culled instances, bytes per frame to start with, doubled as needed
+const GLsizeiptr STORAGE_RING_FRAME_SIZE = 256 * 1024;
+
+// static meshes drawn from one packed buffer with glMultiDrawElementsIndirect, M toggles at runtime
+const bool MULTI_DRAW_INDIRECT = true;
+// compute pass zeroing the indirect commands of static meshes outside the view frustum
+const bool GPU_FRUSTUM_CULLING = true;
+// depth pre-pass of the walls and pillar, Hi-Z pyramid and occlusion test in the culling pass
+const bool HIZ_OCCLUSION_CULLING = true;
+const int  HIZ_WIDTH = 512;  // occluder depth resolution
+const int  HIZ_HEIGHT = 360;
+// AABB tests on the CPU for the chair instances, the train, the statue and the per-mesh path
+const bool CPU_FRUSTUM_CULLING = true;
+
+// opaque geometry is first drawn depth-only and then shaded with GL_EQUAL, P toggles at runtime
+const bool DEPTH_PREPASS = true;
+
+// G-buffer + light volumes instead of the forward shaders, G toggles at runtime
+const bool DEFERRED_SHADING = false;
+const int  MAX_LIGHTS = 1024;  // size of the light buffer
+const int  LIGHT_COUNT = 64;   // main light, train spotlight and lot spotlights
+
+// forward shading with per-cluster light lists built by a compute pass, C toggles at runtime
+const bool  CLUSTERED_LIGHTING = false;
+const int   CLUSTER_X = 16;           // screen tiles
+const int   CLUSTER_Y = 9;
+const int   CLUSTER_Z = 24;           // exponential depth slices from NEAR to CLUSTER_FAR, the last reaches FAR
+const float CLUSTER_FAR = 40.0f;
+const int   MAX_CLUSTER_LIGHTS = 128; // further lights of a cluster are dropped
+
+// frame statistics log, 0 = off
+const int FRAME_STATS_INTERVAL = 600;
+// GPU time of every pass from timestamp queries, averaged over the last GPU_TIMING_WINDOW frames in the log
+const bool GPU_PASS_TIMERS = true;
+const int  GPU_TIMING_WINDOW = 60;
+// CPU timing markers in per-thread rings, T writes them to TRACE_FILE as Chrome trace JSON
+const bool CPU_TRACE = true;
+const int  TRACE_RING_EVENTS = 1 << 16; // per thread
+const char* const TRACE_FILE = "trace.json";
+
+// --headless, frames rendered into the offscreen framebuffer after the warm-up
+const int HEADLESS_FRAMES = 500;
+
 // window
 const int   WIDTH = 1024;
 const int   HEIGHT = 720;
 const float FOV = 45.0f; // in degrees 
 const float NEAR = 1.0f;
 const float FAR = 1000.0f;
-// camera
-const float MOVEMENT_SPEED = 0.1f;
+// swap interval 1, false renders as fast as possible, V toggles at runtime
+const bool  VSYNC = true;
+// simulation, fixed steps independent of the frame rate, speeds are per second of simulated time
+const double SIMULATION_STEP = 1.0 / 60.0; // seconds
+const double MAX_FRAME_TIME = 0.25;        // longer frames are clamped, the simulation slows down
+// camera, MOVEMENT_SPEED units per second while a key is held (the old key repeat rate),
+// ROTATION_SPEED per pixel of mouse movement
+const float MOVEMENT_SPEED = 3.0f;
 const float ROTATION_SPEED = 0.02f;
-// models
-const float TRAIN_ROTATION_SPEED= 0.01f;
+// models, radians per second
+const float TRAIN_ROTATION_SPEED = 0.6f;
+// chair grid, drawn with one instanced draw call
+const int   CHAIR_ROWS = 2;
+const int   CHAIR_COLUMNS = 4;
+const float CHAIR_ROW_SPACING = 2.0f;
+const float CHAIR_COLUMN_SPACING = 1.5f;
 
 const glm::vec3 train_position = glm::vec3(3.49634f, 1.92977f, -1.15591f);
 
@@ -32,6 +119,51 @@ struct Vertex {
     glm::vec2 uv;
 };
 
+// lightweight handle to a mesh uploaded to the GPU, CPU-side vertices are not kept
+struct Mesh {
+    GLuint vbo;
+    GLuint ebo;             // 0 for non-indexed meshes
+    GLuint vao;
+    GLsizei vertex_count;
+    GLsizei index_count;
+    glm::vec3 bounds_min; // model space AABB
+    glm::vec3 bounds_max;
+};
+
+// CPU-side mesh ready for upload, parsed from OBJ or viewed straight from a mapped cache file
+struct MeshData {
+    std::vector<Vertex> vertex_storage; // parsed vertices, empty when mapped
+    std::vector<GLuint> index_storage;
+    const void* mapping;                // mapped cache file, null when parsed
+    size_t mapping_size;
+    size_t vertex_offset;               // byte offsets of the arrays in the mapping
+    size_t index_offset;
+    GLsizei vertex_count;
+    GLsizei index_count;
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+
+    MeshData() : mapping(NULL), mapping_size(0), vertex_offset(0), index_offset(0),
+                 vertex_count(0), index_count(0), bounds_min(0.0f), bounds_max(0.0f) {}
+
+    const Vertex* vertices() const {
+        return mapping ? reinterpret_cast<const Vertex*>(static_cast<const char*>(mapping) + vertex_offset)
+                       : vertex_storage.data();
+    }
+
+    const GLuint* indices() const {
+        return mapping ? reinterpret_cast<const GLuint*>(static_cast<const char*>(mapping) + index_offset)
+                       : index_storage.data();
+    }
+};
+
+// decoded RGBA8 pixels, freed with freeImage
+struct ImageData {
+    int width;
+    int height;
+    unsigned char* pixels;
+};
+
 struct Camera {
     glm::vec3 eye_pos;
     glm::vec3 view_dir;
@@ -54,6 +186,13 @@ struct ModelUBO {
     float shininess; // specular light multiplier
 };
 
+// per-instance data in an std430 SSBO, padded to the 16 byte array stride
+struct InstanceData {
+    glm::mat4 model_matrix;
+    float shininess;
+    float padding[3];
+};
+
 /* ==================== VARIABLES ==================== */
 
 static Camera camera = {
@@ -69,23 +208,45 @@ static double last_cursor_y = 0.0;
 // for building train model matrix
 static float  train_rotation_angle = 0.0f;
 
+// set by setTrainRotation, the angle then only changes through it
+static bool TRAIN_ANGLE_SCRIPTED = false;
+
 // camera rotation only when LMB pressed, true if LMB down
 static bool CAMERA_ROTATION_ENABLED = false;
 
+// swap interval of the window
+static bool VSYNC_ENABLED = VSYNC;
+
+// static meshes through the packed multi-draw path, false = one draw per mesh
+static bool MULTI_DRAW_ENABLED = MULTI_DRAW_INDIRECT;
+
+// depth pre-pass before the opaque shading pass
+static bool DEPTH_PREPASS_ENABLED = DEPTH_PREPASS;
+
+// O shows how many times each pixel is shaded instead of the scene
+static bool OVERDRAW_VIEW_ENABLED = false;
+
 // programs
-static GLuint default_program, floor_program, texture_program, skybox_program, statue_program;
+static GLuint default_program, floor_program, texture_program, instanced_program, indirect_program, skybox_program, statue_program;
+// depth-only and overdraw variants, one per vertex shader
+static GLuint depth_program, depth_instanced_program, depth_indirect_program;
+static GLuint overdraw_program, overdraw_instanced_program, overdraw_indirect_program;
+// G-buffer variants for deferred shading, floor and statue write their own material
+static GLuint gbuffer_program, gbuffer_floor_program, gbuffer_statue_program, gbuffer_instanced_program, gbuffer_indirect_program;
+// clustered lighting variants, the light loop replaces the fixed two lights
+static GLuint clustered_program, clustered_floor_program, clustered_instanced_program, clustered_indirect_program;
 
 // textures
 static GLuint walls_texture, stand_texture, light_wood_texture, dark_wood_texture, balcony_texture, spot_texture, skybox_texture, gold_texture;
 
-// VBOs
-static GLuint walls_vbo, chair_vbo, stand_vbo, windows_vbo, balcony_vbo, podium_vbo, statue_vbo, floor_vbo, train_vbo, pillar_vbo, skybox_vbo;
+// meshes
+static Mesh walls_mesh, chair_mesh, stand_mesh, windows_mesh, balcony_mesh, podium_mesh, statue_mesh, floor_mesh, train_mesh, pillar_mesh;
 
-// VAOs
-static GLuint walls_vao, chair_vao, stand_vao, windows_vao, balcony_vao, podium_vao, statue_vao, floor_vao, train_vao, pillar_vao, skybox_vao;
+// skybox
+static GLuint skybox_vbo, skybox_vao;
 
 // buffers
-static GLuint camera_buffer, model_buffer;
+static GLuint chair_instance_buffer;
 
 // UBOs
 static CameraUBO camera_ubo = {
@@ -144,18 +305,71 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
 
-void drawModel(std::vector<Vertex> model, GLuint vao, GLuint program, GLuint texture, ModelUBO ubo);
+// places the camera, up stays +Y
+void setCamera(const glm::vec3& eye_pos, const glm::vec3& view_dir);
+
+// places the camera with its own up direction, for scripted camera paths
+void setCamera(const glm::vec3& eye_pos, const glm::vec3& view_dir, const glm::vec3& up_dir);
+
+// fixes the train at angle (radians), draw() stops advancing it
+void setTrainRotation(float angle);
+
+// framebuffer the frame ends in, 0 = the window, the offscreen target in headless mode
+void setSceneFramebuffer(GLuint framebuffer);
+
+GLuint sceneFramebuffer();
+
+void drawMesh(const Mesh& mesh);
+
+void drawMeshInstanced(const Mesh& mesh, GLsizei instance_count);
 
 std::string getFileContent(const char* filename);
 
-GLuint createShader(const char* filename, GLenum type);
+std::vector<std::string> listFiles(const char* directory, const char* extension);
+
+// text as the inside of a JSON string, quotes, backslashes and control characters escaped
+std::string jsonEscape(const char* text);
+
+// fragment shaders built with LIGHTING_DEFINE get LIGHTING_SHADER after their defines
+bool usesLightingShader(const char* filename, const char* defines);
+
+// file contents with the defines inserted after the #version line
+std::string shaderSource(const char* filename, const char* defines = "");
+
+// GL_COMPILE_STATUS of a shader or GL_LINK_STATUS of a program, prints the info log on failure
+bool checkStatus(GLuint ID, GLenum status, const char* name);
+
+// compiled shader, throws after printing the info log if compilation fails
+GLuint createShader(const char* filename, GLenum type, const char* defines = "");
+
+// program from the program cache, or compiled and linked without waiting for the driver, usable
+// right away as GL waits on first use, errors are reported by finishPrograms()
+GLuint createProgram(const char* vert_name, const char* frag_name, const char* defines = "");
 
-GLuint createProgram(const char* vert_name, const char* frag_name);
+GLuint createComputeProgram(const char* comp_name, const char* defines = "");
 
-GLuint createObjectVBO(std::vector<Vertex> model);
+// checks the programs created since the last call and caches their binaries, throws after printing
+// the info log if one failed
+void finishPrograms();
 
-GLuint createObjectVAO(GLuint data_vbo);
+GLuint createObjectVBO(const Vertex* vertices, GLsizei vertex_count);
+
+GLuint createObjectEBO(const GLuint* indices, GLsizei index_count);
+
+GLuint createObjectVAO(GLuint data_vbo, GLuint index_ebo);
+
+Mesh createMesh(const MeshData& data);
+
+ImageData loadImage(const char* file_name, bool flip);
+
+void freeImage(ImageData& image);
+
+GLuint createTexture(const ImageData& image);
 
 GLuint createTexture(const char* file_name);
 
-std::vector<Vertex> loadOBJFile(const char* file_name);
\ No newline at end of file
+MeshData parseOBJ(const char* data, size_t size);
+
+MeshData loadOBJFile(const char* file_name);
+
+void computeBounds(const Vertex* vertices, size_t count, glm::vec3& bounds_min, glm::vec3& bounds_max);
\ No newline at end of file
@@ -0,0 +1,401 @@
+#include "application.hpp"
+#include "benchmark.hpp"
+#include "culling.hpp"
+#include "lights.hpp"
+#include "deferred.hpp"
+#include "clusters.hpp"
+#include "frame_stats.hpp"
+#include "camera_path.hpp"
+#include "gpu_profiler.hpp"
+#include <chrono>
+#include <algorithm>
+
+// repetitions per file, best run is reported
+static const int OBJ_BENCHMARK_RUNS = 5;
+
+// repetitions per box count for the culling benchmark, best run is reported
+static const int CULLING_BENCHMARK_RUNS = 20;
+
+// frames per light count for the lights benchmark, warm-up frames fill the query ring first
+static const int LIGHTS_WARMUP_FRAMES = 30;
+static const int LIGHTS_BENCHMARK_FRAMES = 200;
+
+// frames of a camera path replay, spread evenly over its duration
+static const int PATH_WARMUP_FRAMES = 30;
+static const int PATH_BENCHMARK_FRAMES = 600;
+
+// the original getline + stringstream loader, kept as the reference implementation
+static std::vector<Vertex> loadOBJFileStream(const char* file_name)
+{
+	std::vector<glm::fvec3> vertex_positions;
+	std::vector<glm::fvec2> vertex_texcoords;
+	std::vector<glm::fvec3> vertex_normals;
+
+	std::vector<GLint> vertex_position_indicies;
+	std::vector<GLint> vertex_texcoord_indicies;
+	std::vector<GLint> vertex_normal_indicies;
+
+	std::vector<Vertex> vertices;
+
+	std::stringstream ss;
+	std::ifstream in_file(file_name);
+	std::string line = "";
+	std::string prefix = "";
+	glm::vec3 temp_vec3;
+	glm::vec2 temp_vec2;
+	GLint temp_glint = 0;
+
+	if (!in_file.is_open())
+	{
+		throw "ERROR::OBJLOADER::Could not open file.";
+	}
+
+	while (std::getline(in_file, line))
+	{
+		ss.clear();
+		ss.str(line);
+		ss >> prefix;
+
+		if (prefix == "v")
+		{
+			ss >> temp_vec3.x >> temp_vec3.y >> temp_vec3.z;
+			vertex_positions.push_back(temp_vec3);
+		}
+		else if (prefix == "vt")
+		{
+			ss >> temp_vec2.x >> temp_vec2.y;
+			vertex_texcoords.push_back(temp_vec2);
+		}
+		else if (prefix == "vn")
+		{
+			ss >> temp_vec3.x >> temp_vec3.y >> temp_vec3.z;
+			vertex_normals.push_back(temp_vec3);
+		}
+		else if (prefix == "f")
+		{
+			int counter = 0;
+			while (ss >> temp_glint)
+			{
+				if (counter == 0)
+					vertex_position_indicies.push_back(temp_glint);
+				else if (counter == 1)
+					vertex_texcoord_indicies.push_back(temp_glint);
+				else if (counter == 2)
+					vertex_normal_indicies.push_back(temp_glint);
+
+				if (ss.peek() == '/')
+				{
+					++counter;
+					ss.ignore(1, '/');
+				}
+				else if (ss.peek() == ' ')
+				{
+					++counter;
+					ss.ignore(1, ' ');
+				}
+
+				if (counter > 2)
+					counter = 0;
+			}
+		}
+	}
+
+	vertices.resize(vertex_position_indicies.size(), Vertex());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		vertices[i].position = vertex_positions[vertex_position_indicies[i] - 1];
+		vertices[i].uv = vertex_texcoords[vertex_texcoord_indicies[i] - 1];
+		vertices[i].normal = vertex_normals[vertex_normal_indicies[i] - 1];
+	}
+	return vertices;
+}
+
+// same as loadOBJFile without the log lines, expanded back to one vertex per corner for comparison
+static std::vector<Vertex> loadOBJFileFast(const char* file_name)
+{
+	std::string content = getFileContent(file_name);
+	MeshData mesh = parseOBJ(content.data(), content.size());
+
+	std::vector<Vertex> vertices(mesh.index_count);
+	for (GLsizei i = 0; i < mesh.index_count; i++) {
+		vertices[i] = mesh.vertex_storage[mesh.index_storage[i]];
+	}
+	return vertices;
+}
+
+static bool sameVertices(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+{
+	if (a.size() != b.size()) { return false; }
+	for (size_t i = 0; i < a.size(); i++) {
+		if (glm::distance(a[i].position, b[i].position) > 1e-5f) { return false; }
+		if (glm::distance(a[i].normal, b[i].normal) > 1e-5f) { return false; }
+		if (std::fabs(a[i].uv.x - b[i].uv.x) > 1e-5f || std::fabs(a[i].uv.y - b[i].uv.y) > 1e-5f) { return false; }
+	}
+	return true;
+}
+
+template <typename Loader>
+static double bestRunSeconds(Loader loader, const char* file_name, std::vector<Vertex>& result)
+{
+	double best = 1e30;
+	for (int i = 0; i < OBJ_BENCHMARK_RUNS; i++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		result = loader(file_name);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+int benchmarkOBJLoader()
+{
+	std::vector<std::string> files = listFiles("obj", ".obj");
+	if (files.empty()) {
+		std::cout << "no OBJ files found, run from the repository root" << std::endl;
+		return 1;
+	}
+
+	std::printf("%-20s %10s %12s %12s %9s  %s\n", "file", "size [MB]", "stream MB/s", "fast MB/s", "speedup", "check");
+	double total_size = 0.0, total_stream = 0.0, total_fast = 0.0;
+	for (size_t i = 0; i < files.size(); i++) {
+		const char* file_name = files[i].c_str();
+		double size = double(getFileContent(file_name).size()) / (1024.0 * 1024.0);
+
+		std::vector<Vertex> reference, parsed;
+		double stream_time = bestRunSeconds(loadOBJFileStream, file_name, reference);
+		double fast_time = bestRunSeconds(loadOBJFileFast, file_name, parsed);
+
+		// the old loader does not triangulate polygons, so only triangle meshes can be compared
+		const char* check = sameVertices(reference, parsed) ? "ok" : "differs";
+
+		std::printf("%-20s %10.3f %12.1f %12.1f %8.1fx  %s\n", file_name, size,
+			size / stream_time, size / fast_time, stream_time / fast_time, check);
+		total_size += size;
+		total_stream += stream_time;
+		total_fast += fast_time;
+	}
+	std::printf("%-20s %10.3f %12.1f %12.1f %8.1fx\n", "total", total_size,
+		total_size / total_stream, total_size / total_fast, total_stream / total_fast);
+	return 0;
+}
+
+template <typename Culler>
+static double bestCullSeconds(Culler culler, const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint8_t>& visible, size_t& visible_count)
+{
+	double best = 1e30;
+	for (int i = 0; i < CULLING_BENCHMARK_RUNS; i++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		visible_count = culler(frustum, boxes, visible.data());
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+int benchmarkCulling()
+{
+	// camera in the middle of a square lot of chairs, looking along -z
+	glm::mat4 projection = glm::perspective(FOV, float(WIDTH) / float(HEIGHT), NEAR, FAR);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.5f, 0.0f), glm::vec3(0.0f, 1.5f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	Frustum frustum = extractFrustum(projection * view);
+
+	const size_t counts[] = { 1000, 10000, 100000, 1000000 };
+	std::printf("%-10s %10s %14s %14s %9s  %s\n", "boxes", "visible", "scalar box/ms", "simd box/ms", "speedup", "check");
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		size_t count = counts[c];
+		int side = int(std::ceil(std::sqrt(double(count))));
+
+		BoundingBoxes boxes;
+		resizeBoxes(boxes, count);
+		for (size_t i = 0; i < count; i++) {
+			glm::vec3 position((int(i) % side - side / 2) * CHAIR_COLUMN_SPACING, 0.0f, (int(i) / side - side / 2) * CHAIR_ROW_SPACING);
+			setBox(boxes, i, glm::vec3(-0.3f, 0.0f, -0.3f), glm::vec3(0.3f, 1.0f, 0.3f), glm::translate(glm::mat4(1.0f), position));
+		}
+
+		std::vector<uint8_t> reference(count), visible(count);
+		size_t reference_count = 0, visible_count = 0;
+		double scalar_time = bestCullSeconds(cullBoxesScalar, frustum, boxes, reference, reference_count);
+		double simd_time = bestCullSeconds(cullBoxes, frustum, boxes, visible, visible_count);
+		const char* check = reference == visible && reference_count == visible_count ? "ok" : "differs";
+
+		std::printf("%-10zu %10zu %14.0f %14.0f %8.1fx  %s\n", count, visible_count,
+			count / (scalar_time * 1000.0), count / (simd_time * 1000.0), scalar_time / simd_time, check);
+	}
+	return 0;
+}
+
+static void renderBenchmarkFrame(GLFWwindow* window)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	draw();
+	if (window) {
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+	}
+	else {
+		glFlush();
+	}
+}
+
+struct FrameTimes {
+	double frame_ms;
+	double pass_ms[GPU_PASS_COUNT]; // from the pass timers, 0 for passes that did not run
+};
+
+// warm-up frames, then averages over LIGHTS_BENCHMARK_FRAMES frames, GPU times over the frames read back
+static FrameTimes measureFrames(GLFWwindow* window)
+{
+	for (int i = 0; i < LIGHTS_WARMUP_FRAMES; i++) { renderBenchmarkFrame(window); }
+
+	FrameTimes times = FrameTimes();
+	int pass_samples[GPU_PASS_COUNT] = {};
+	long readback_serial = gpuReadbackSerial();
+	glFinish();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < LIGHTS_BENCHMARK_FRAMES; i++) {
+		renderBenchmarkFrame(window);
+		if (gpuReadbackSerial() == readback_serial) { continue; }
+		readback_serial = gpuReadbackSerial();
+		for (int p = 0; p < GPU_PASS_COUNT; p++) {
+			double ms;
+			if (gpuPassTime(GpuPass(p), ms)) {
+				times.pass_ms[p] += ms;
+				pass_samples[p]++;
+			}
+		}
+	}
+	glFinish();
+	times.frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / LIGHTS_BENCHMARK_FRAMES;
+	for (int p = 0; p < GPU_PASS_COUNT; p++) {
+		if (pass_samples[p]) { times.pass_ms[p] /= pass_samples[p]; }
+	}
+	return times;
+}
+
+// above the entrance, looking down over the lots
+static void setBenchmarkView()
+{
+	setCamera(glm::vec3(0.0f, 5.0f, 7.0f), glm::vec3(0.0f, -0.5f, -1.0f));
+	glfwSwapInterval(0);
+}
+
+int benchmarkLights(GLFWwindow* window)
+{
+	setBenchmarkView();
+	setDeferredShading(true);
+
+	std::printf("%-8s %10s %12s %12s %14s\n", "lights", "frame ms", "gbuffer ms", "lighting ms", "us per light");
+	for (int count = 1; count <= MAX_LIGHTS; count *= 2) {
+		setLightCount(count);
+		FrameTimes times = measureFrames(window);
+		double lighting_ms = times.pass_ms[GPU_PASS_LIGHTING];
+		std::printf("%-8d %10.3f %12.3f %12.3f %14.3f\n", count, times.frame_ms, times.pass_ms[GPU_PASS_GBUFFER], lighting_ms,
+			lighting_ms * 1000.0 / count);
+	}
+	return 0;
+}
+
+int benchmarkClustered(GLFWwindow* window)
+{
+	setBenchmarkView();
+	setDeferredShading(false);
+
+	setClusteredLighting(false);
+	FrameTimes fixed = measureFrames(window);
+	std::printf("fixed two-light shaders: %.3f ms per frame\n", fixed.frame_ms);
+
+	setClusteredLighting(true);
+	const int counts[] = { 1, 64, MAX_LIGHTS };
+	std::printf("%-8s %10s %12s %10s\n", "lights", "frame ms", "binning ms", "vs fixed");
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		setLightCount(counts[c]);
+		FrameTimes times = measureFrames(window);
+		std::printf("%-8d %10.3f %12.3f %9.2fx\n", counts[c], times.frame_ms, times.pass_ms[GPU_PASS_CLUSTERS], times.frame_ms / fixed.frame_ms);
+	}
+	return 0;
+}
+
+static void applyCameraPath(const CameraPath& path, float time)
+{
+	Camera sample;
+	float train_angle;
+	sampleCameraPath(path, time, sample, train_angle);
+	setCamera(sample.eye_pos, sample.view_dir, sample.up_dir);
+	setTrainRotation(train_angle);
+}
+
+static void printSummary(const char* name, const TimeSummary& s)
+{
+	std::printf("%-12s %9.3f %9.3f %9.3f %9.3f %9.3f\n", name, s.min, s.avg, s.p95, s.p99, s.max);
+}
+
+static void writeSummary(FILE* file, const char* name, const TimeSummary& s, bool last)
+{
+	std::fprintf(file, "    \"%s\": { \"min\": %.4f, \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+		name, s.min, s.avg, s.p50, s.p95, s.p99, s.max, last ? "" : ",");
+}
+
+int benchmarkCameraPath(GLFWwindow* window, const char* path_file, int frame_count, const char* json_file)
+{
+	CameraPath path;
+	if (!loadCameraPath(path_file, path)) { return 1; }
+	if (frame_count <= 0) { frame_count = PATH_BENCHMARK_FRAMES; }
+	if (window) { glfwSwapInterval(0); }
+
+	// warm-up at the start of the path, textures stream in and the query rings fill
+	applyCameraPath(path, 0.0f);
+	for (int i = 0; i < PATH_WARMUP_FRAMES; i++) { renderBenchmarkFrame(window); }
+	glFinish();
+
+	// GPU pass times from the pass timers, a few frames late, once per frame read back and only for the
+	// passes that ran in it
+	std::vector<double> frame_ms(frame_count), pass_ms[GPU_PASS_COUNT];
+	long readback_serial = gpuReadbackSerial();
+	std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frame_count; i++) {
+		applyCameraPath(path, frame_count > 1 ? path.duration * i / (frame_count - 1) : 0.0f);
+		renderBenchmarkFrame(window);
+		std::chrono::steady_clock::time_point frame_end = std::chrono::steady_clock::now();
+		frame_ms[i] = std::chrono::duration<double, std::milli>(frame_end - frame_start).count();
+		frame_start = frame_end;
+
+		if (gpuReadbackSerial() == readback_serial) { continue; }
+		readback_serial = gpuReadbackSerial();
+		for (int p = 0; p < GPU_PASS_COUNT; p++) {
+			double ms;
+			if (gpuPassTime(GpuPass(p), ms)) { pass_ms[p].push_back(ms); }
+		}
+	}
+	glFinish();
+
+	TimeSummary cpu = summarizeTimes(frame_ms);
+	std::printf("%s: %d frames over %.1f s of path\n", path_file, frame_count, path.duration);
+	std::printf("%-12s %9s %9s %9s %9s %9s\n", "ms", "min", "avg", "p95", "p99", "max");
+	printSummary("cpu frame", cpu);
+	for (int p = 0; p < GPU_PASS_COUNT; p++) {
+		if (!pass_ms[p].empty()) { printSummary(gpuPassName(GpuPass(p)), summarizeTimes(pass_ms[p])); }
+	}
+
+	if (json_file) {
+		FILE* file = std::fopen(json_file, "w");
+		if (!file) {
+			std::printf("%s: could not write the results\n", json_file);
+			return 1;
+		}
+		std::fprintf(file, "{\n  \"path\": \"%s\",\n  \"frames\": %d,\n  \"renderer\": \"%s\",\n",
+			jsonEscape(path_file).c_str(), frame_count, jsonEscape((const char*)glGetString(GL_RENDERER)).c_str());
+		std::fprintf(file, "  \"cpu_frame_ms\": {\n");
+		writeSummary(file, "frame", cpu, true);
+		std::fprintf(file, "  },\n  \"gpu_pass_ms\": {\n");
+		int last = -1;
+		for (int p = 0; p < GPU_PASS_COUNT; p++) {
+			if (!pass_ms[p].empty()) { last = p; }
+		}
+		for (int p = 0; p <= last; p++) {
+			if (!pass_ms[p].empty()) { writeSummary(file, gpuPassName(GpuPass(p)), summarizeTimes(pass_ms[p]), p == last); }
+		}
+		std::fprintf(file, "  }\n}\n");
+		std::fclose(file);
+	}
+	return 0;
+}
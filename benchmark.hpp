@@ -0,0 +1,22 @@
+#pragma once
+
+struct GLFWwindow;
+
+/* ==================== BENCHMARKS ==================== */
+
+// parses every file in obj/ with the old stringstream loader and with parseOBJ, prints MB/s
+int benchmarkOBJLoader();
+
+// culls a field of chair-sized boxes around the camera with cullBoxesScalar and cullBoxes, prints boxes/ms
+int benchmarkCulling();
+
+// renders the hall with deferred shading at 1, 2, 4 .. MAX_LIGHTS lights, prints frame and GPU pass times, needs init()
+int benchmarkLights(GLFWwindow* window);
+
+// forward shading with the fixed two-light shaders, then clustered at 1, 64 and MAX_LIGHTS lights, needs init()
+int benchmarkClustered(GLFWwindow* window);
+
+// replays a camera path file over frame_count frames (0 = PATH_BENCHMARK_FRAMES), prints CPU frame time
+// and GPU time statistics of every pass and writes them to json_file when set, needs init(), a NULL window
+// renders into the scene framebuffer without presenting
+int benchmarkCameraPath(GLFWwindow* window, const char* path_file, int frame_count, const char* json_file);
@@ -0,0 +1,86 @@
+#include "camera_path.hpp"
+#include <algorithm>
+
+bool loadCameraPath(const char* file_name, CameraPath& path)
+{
+	std::ifstream in_file(file_name);
+	if (!in_file.is_open()) {
+		std::printf("%s: could not open camera path\n", file_name);
+		return false;
+	}
+
+	path = CameraPath();
+	std::string line;
+	for (int line_number = 1; std::getline(in_file, line); line_number++) {
+		size_t comment = line.find('#');
+		if (comment != std::string::npos) { line.resize(comment); }
+
+		char kind[16] = "";
+		if (std::sscanf(line.c_str(), "%15s", kind) != 1) { continue; } // blank line
+
+		bool ok = false;
+		if (std::string(kind) == "camera") {
+			CameraKey key;
+			Camera& c = key.camera;
+			ok = std::sscanf(line.c_str(), "%*s %f %f %f %f %f %f %f %f %f %f", &key.time,
+				&c.eye_pos.x, &c.eye_pos.y, &c.eye_pos.z, &c.view_dir.x, &c.view_dir.y, &c.view_dir.z,
+				&c.up_dir.x, &c.up_dir.y, &c.up_dir.z) == 10
+				&& glm::length(c.view_dir) > 0.0f && glm::length(c.up_dir) > 0.0f
+				&& (path.camera_keys.empty() || key.time > path.camera_keys.back().time);
+			if (ok) { path.camera_keys.push_back(key); }
+		}
+		else if (std::string(kind) == "train") {
+			TrainKey key;
+			ok = std::sscanf(line.c_str(), "%*s %f %f", &key.time, &key.angle) == 2
+				&& (path.train_keys.empty() || key.time > path.train_keys.back().time);
+			if (ok) { path.train_keys.push_back(key); }
+		}
+
+		if (!ok) {
+			std::printf("%s:%d: expected 'camera <time> <eye> <view> <up>' or 'train <time> <angle>' with increasing times\n",
+				file_name, line_number);
+			return false;
+		}
+		path.duration = std::max(path.duration, path.camera_keys.empty() ? 0.0f : path.camera_keys.back().time);
+		path.duration = std::max(path.duration, path.train_keys.empty() ? 0.0f : path.train_keys.back().time);
+	}
+
+	if (path.camera_keys.empty()) {
+		std::printf("%s: no camera keyframes\n", file_name);
+		return false;
+	}
+	return true;
+}
+
+// index of the last key at or before time and the blend factor towards the next one
+template <typename Key>
+static size_t findSegment(const std::vector<Key>& keys, float time, float& t)
+{
+	size_t i = 0;
+	while (i + 1 < keys.size() && keys[i + 1].time <= time) { i++; }
+	if (i + 1 == keys.size() || time <= keys[i].time) {
+		t = 0.0f;
+	}
+	else {
+		t = (time - keys[i].time) / (keys[i + 1].time - keys[i].time);
+	}
+	return i;
+}
+
+void sampleCameraPath(const CameraPath& path, float time, Camera& camera, float& train_angle)
+{
+	float t;
+	size_t i = findSegment(path.camera_keys, time, t);
+	const Camera& a = path.camera_keys[i].camera;
+	const Camera& b = path.camera_keys[std::min(i + 1, path.camera_keys.size() - 1)].camera;
+	camera.eye_pos = glm::mix(a.eye_pos, b.eye_pos, t);
+	camera.view_dir = glm::normalize(glm::mix(glm::normalize(a.view_dir), glm::normalize(b.view_dir), t));
+	camera.up_dir = glm::normalize(glm::mix(glm::normalize(a.up_dir), glm::normalize(b.up_dir), t));
+
+	train_angle = 0.0f;
+	if (!path.train_keys.empty()) {
+		i = findSegment(path.train_keys, time, t);
+		const TrainKey& next = path.train_keys[std::min(i + 1, path.train_keys.size() - 1)];
+		train_angle = glm::mix(path.train_keys[i].angle, next.angle, t);
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== CAMERA PATHS ==================== */
+
+// Scripted camera movement for repeatable benchmarks. A path file is plain text, one keyframe per
+// line, '#' starts a comment:
+//
+//     camera <time> <eye x y z> <view x y z> <up x y z>
+//     train  <time> <angle>
+//
+// Times are in seconds and increase within each kind. The camera is interpolated linearly between
+// its keyframes (directions renormalized), the train angle in radians on its own timeline, and
+// both hold their first and last value outside it.
+
+struct CameraKey {
+    float time;
+    Camera camera;
+};
+
+struct TrainKey {
+    float time;
+    float angle;
+};
+
+struct CameraPath {
+    std::vector<CameraKey> camera_keys;
+    std::vector<TrainKey> train_keys; // empty = angle 0
+    float duration;                   // last keyframe time of either kind
+};
+
+// parses a path file, false after printing the file and line that could not be read
+bool loadCameraPath(const char* file_name, CameraPath& path);
+
+// camera and train angle at time, the path has at least one camera keyframe
+void sampleCameraPath(const CameraPath& path, float time, Camera& camera, float& train_angle);
@@ -0,0 +1,62 @@
+#include "clusters.hpp"
+#include "lights.hpp"
+#include "frame_stats.hpp"
+#include <sstream>
+
+static const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+static GLuint cluster_program, cluster_buffer;
+static bool clustered_enabled = CLUSTERED_LIGHTING;
+
+const char* clusterShaderDefines()
+{
+	static std::string defines;
+	if (defines.empty()) {
+		std::ostringstream out;
+		out << LIGHTING_DEFINE
+		    << "#define CLUSTERED_LIGHTING\n"
+		    << "#define CLUSTER_X " << CLUSTER_X << "\n"
+		    << "#define CLUSTER_Y " << CLUSTER_Y << "\n"
+		    << "#define CLUSTER_Z " << CLUSTER_Z << "\n"
+		    << "#define CLUSTER_NEAR " << std::showpoint << NEAR << "\n"
+		    << "#define CLUSTER_FAR " << CLUSTER_FAR << "\n"
+		    << "#define CLUSTER_LAST_FAR " << FAR << "\n"
+		    << "#define MAX_CLUSTER_LIGHTS " << MAX_CLUSTER_LIGHTS << "u\n"
+		    << "#define SCREEN_SIZE vec2(" << WIDTH << ".0, " << HEIGHT << ".0)\n";
+		defines = out.str();
+	}
+	return defines.c_str();
+}
+
+void initClusters()
+{
+	cluster_program = createComputeProgram("shaders/cluster_lights.comp", clusterShaderDefines());
+
+	// per cluster: light count, then the indices
+	glCreateBuffers(1, &cluster_buffer);
+	glNamedBufferStorage(cluster_buffer, CLUSTER_COUNT * (MAX_CLUSTER_LIGHTS + 1) * sizeof(GLuint), NULL, 0);
+}
+
+bool clusteredLighting()
+{
+	return clustered_enabled;
+}
+
+void setClusteredLighting(bool enabled)
+{
+	clustered_enabled = enabled;
+}
+
+void buildClusters(const glm::mat4& view, const glm::mat4& projection)
+{
+	frame_stats.cluster_lights = lightCount();
+
+	glUseProgram(cluster_program);
+	glProgramUniformMatrix4fv(cluster_program, 0, 1, GL_FALSE, glm::value_ptr(view));
+	glProgramUniform2f(cluster_program, 4, projection[0][0], projection[1][1]);
+	glProgramUniform1ui(cluster_program, 5, GLuint(lightCount()));
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, lightBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, cluster_buffer);
+	glDispatchCompute(CLUSTER_X, CLUSTER_Y, CLUSTER_Z);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
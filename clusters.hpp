@@ -0,0 +1,24 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== CLUSTERED LIGHTING ==================== */
+
+// The view frustum is split into CLUSTER_X x CLUSTER_Y screen tiles and CLUSTER_Z exponential depth
+// slices. A compute pass tests the bounding sphere of every light against the view-space box of
+// every cluster and writes a list of up to MAX_CLUSTER_LIGHTS light indices per cluster into an
+// SSBO at binding 5. Fragment shaders built with clusterShaderDefines() get clusterLighting() from
+// LIGHTING_SHADER, which finds the cluster from gl_FragCoord and view depth and loops over its list,
+// reading the lights at binding 4.
+
+// needs a GL context and initLights()
+void initClusters();
+
+bool clusteredLighting();
+
+void setClusteredLighting(bool enabled);
+
+// LIGHTING_DEFINE, CLUSTERED_LIGHTING and the grid constants for the shaders, no GL needed
+const char* clusterShaderDefines();
+
+// bins the lights for this view and binds the light and cluster buffers for the shading passes
+void buildClusters(const glm::mat4& view, const glm::mat4& projection);
@@ -0,0 +1,149 @@
+#include "culling.hpp"
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define CULLING_SSE 1
+#endif
+
+static glm::vec4 normalizePlane(const glm::vec4& plane)
+{
+	float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+	return plane / length;
+}
+
+Frustum extractFrustum(const glm::mat4& view_projection)
+{
+	// rows of the column-major matrix
+	const glm::mat4& m = view_projection;
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	Frustum frustum;
+	frustum.planes[0] = normalizePlane(row3 + row0); // left
+	frustum.planes[1] = normalizePlane(row3 - row0); // right
+	frustum.planes[2] = normalizePlane(row3 + row1); // bottom
+	frustum.planes[3] = normalizePlane(row3 - row1); // top
+	frustum.planes[4] = normalizePlane(row3 + row2); // near
+	frustum.planes[5] = normalizePlane(row3 - row2); // far
+	return frustum;
+}
+
+glm::vec4 boundingSphere(const glm::vec3& bounds_min, const glm::vec3& bounds_max, const glm::mat4& model_matrix)
+{
+	glm::vec4 center = model_matrix * glm::vec4((bounds_min + bounds_max) * 0.5f, 1.0f);
+
+	// radius grows with the largest axis scale of the model matrix
+	float scale = std::max(glm::length(glm::vec3(model_matrix[0])),
+	              std::max(glm::length(glm::vec3(model_matrix[1])), glm::length(glm::vec3(model_matrix[2]))));
+	float radius = glm::length(bounds_max - bounds_min) * 0.5f * scale;
+
+	return glm::vec4(center.x, center.y, center.z, radius);
+}
+
+void resizeBoxes(BoundingBoxes& boxes, size_t count)
+{
+	size_t padded = (count + 3) / 4 * 4;
+	boxes.min_x.assign(padded, 0.0f);
+	boxes.min_y.assign(padded, 0.0f);
+	boxes.min_z.assign(padded, 0.0f);
+	boxes.max_x.assign(padded, 0.0f);
+	boxes.max_y.assign(padded, 0.0f);
+	boxes.max_z.assign(padded, 0.0f);
+	boxes.count = count;
+}
+
+void setBox(BoundingBoxes& boxes, size_t index, const glm::vec3& bounds_min, const glm::vec3& bounds_max, const glm::mat4& model_matrix)
+{
+	// translation, then every matrix element adds its smaller/larger product to the matching axis
+	float box_min[3] = { model_matrix[3][0], model_matrix[3][1], model_matrix[3][2] };
+	float box_max[3] = { model_matrix[3][0], model_matrix[3][1], model_matrix[3][2] };
+	for (int column = 0; column < 3; column++) {
+		for (int row = 0; row < 3; row++) {
+			float a = model_matrix[column][row] * bounds_min[column];
+			float b = model_matrix[column][row] * bounds_max[column];
+			box_min[row] += std::min(a, b);
+			box_max[row] += std::max(a, b);
+		}
+	}
+	boxes.min_x[index] = box_min[0];
+	boxes.min_y[index] = box_min[1];
+	boxes.min_z[index] = box_min[2];
+	boxes.max_x[index] = box_max[0];
+	boxes.max_y[index] = box_max[1];
+	boxes.max_z[index] = box_max[2];
+}
+
+// the box is outside a plane when its corner farthest along the normal is behind it,
+// which corner that is depends only on the plane, so it is picked per plane and not per box
+size_t cullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes, uint8_t* visible)
+{
+	size_t visible_count = 0;
+	for (size_t i = 0; i < boxes.count; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			float x = plane.x >= 0.0f ? boxes.max_x[i] : boxes.min_x[i];
+			float y = plane.y >= 0.0f ? boxes.max_y[i] : boxes.min_y[i];
+			float z = plane.z >= 0.0f ? boxes.max_z[i] : boxes.min_z[i];
+			inside = (plane.x * x + plane.y * y) + (plane.z * z + plane.w) >= 0.0f; // same order as the SSE sum
+		}
+		visible[i] = inside;
+		visible_count += inside;
+	}
+	return visible_count;
+}
+
+#ifdef CULLING_SSE
+
+size_t cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, uint8_t* visible)
+{
+	// per plane: broadcast coefficients and the arrays holding its farthest corner
+	__m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+	const float* corner_x[6];
+	const float* corner_y[6];
+	const float* corner_z[6];
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.planes[p];
+		plane_x[p] = _mm_set1_ps(plane.x);
+		plane_y[p] = _mm_set1_ps(plane.y);
+		plane_z[p] = _mm_set1_ps(plane.z);
+		plane_w[p] = _mm_set1_ps(plane.w);
+		corner_x[p] = plane.x >= 0.0f ? boxes.max_x.data() : boxes.min_x.data();
+		corner_y[p] = plane.y >= 0.0f ? boxes.max_y.data() : boxes.min_y.data();
+		corner_z[p] = plane.z >= 0.0f ? boxes.max_z.data() : boxes.min_z.data();
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	size_t visible_count = 0;
+	for (size_t i = 0; i < boxes.count; i += 4) {
+		__m128 outside = zero;
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(plane_x[p], _mm_loadu_ps(corner_x[p] + i)), _mm_mul_ps(plane_y[p], _mm_loadu_ps(corner_y[p] + i))),
+				_mm_add_ps(_mm_mul_ps(plane_z[p], _mm_loadu_ps(corner_z[p] + i)), plane_w[p]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+		}
+
+		// padding lanes past count are dropped
+		int mask = _mm_movemask_ps(outside);
+		size_t lanes = std::min<size_t>(4, boxes.count - i);
+		for (size_t lane = 0; lane < lanes; lane++) {
+			uint8_t inside = !((mask >> lane) & 1);
+			visible[i + lane] = inside;
+			visible_count += inside;
+		}
+	}
+	return visible_count;
+}
+
+#else
+
+size_t cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, uint8_t* visible)
+{
+	return cullBoxesScalar(frustum, boxes, visible);
+}
+
+#endif
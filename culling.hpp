@@ -0,0 +1,39 @@
+#pragma once
+#include "application.hpp"
+#include <stdint.h>
+
+/* ==================== CULLING ==================== */
+
+// six world space planes, xyz = normal pointing inside, w = distance, normalized
+// order: left, right, bottom, top, near, far
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// planes of the clip volume of proj * view (Gribb-Hartmann)
+Frustum extractFrustum(const glm::mat4& view_projection);
+
+// world space sphere around a model space AABB, xyz = center, w = radius
+glm::vec4 boundingSphere(const glm::vec3& bounds_min, const glm::vec3& bounds_max, const glm::mat4& model_matrix);
+
+// world space AABBs in structure-of-arrays layout, the arrays are padded to a multiple of 4
+// so the SIMD test can load four boxes at once
+struct BoundingBoxes {
+    std::vector<float> min_x, min_y, min_z;
+    std::vector<float> max_x, max_y, max_z;
+    size_t count;
+
+    BoundingBoxes() : count(0) {}
+};
+
+void resizeBoxes(BoundingBoxes& boxes, size_t count);
+
+// stores the world space AABB of a model space AABB transformed by model_matrix (Arvo)
+void setBox(BoundingBoxes& boxes, size_t index, const glm::vec3& bounds_min, const glm::vec3& bounds_max, const glm::mat4& model_matrix);
+
+// visible[i] = 1 if box i is not fully outside one of the planes, returns the number of visible boxes;
+// tests four boxes at a time with SSE when available
+size_t cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, uint8_t* visible);
+
+// one box at a time, same results, used when SSE is not available and as benchmark reference
+size_t cullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes, uint8_t* visible);
@@ -0,0 +1,143 @@
+#include "deferred.hpp"
+#include "lights.hpp"
+#include "frame_stats.hpp"
+
+static GLuint gbuffer_framebuffer, lighting_framebuffer;
+static GLuint albedo_texture, normal_texture, position_texture, depth_texture, lighting_texture;
+static GLuint light_program, unlit_program;
+static GLuint sphere_vbo, sphere_ebo, sphere_vao, empty_vao;
+static GLsizei sphere_index_count;
+
+static bool deferred_enabled = DEFERRED_SHADING;
+
+static GLuint createTarget(GLenum format)
+{
+	GLuint texture;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, 1, format, WIDTH, HEIGHT);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	return texture;
+}
+
+// UV sphere pushed out so its flat faces still enclose the unit sphere
+static void createLightVolume()
+{
+	const int SEGMENTS = 16, RINGS = 8;
+	const float PI = 3.14159265f;
+	float scale = 1.0f / (std::cos(PI / SEGMENTS) * std::cos(PI / (2 * RINGS)));
+
+	std::vector<Vertex> vertices;
+	for (int ring = 0; ring <= RINGS; ring++) {
+		float theta = PI * ring / RINGS;
+		for (int segment = 0; segment <= SEGMENTS; segment++) {
+			float phi = 2.0f * PI * segment / SEGMENTS;
+			Vertex vertex = Vertex();
+			vertex.position = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)) * scale;
+			vertices.push_back(vertex);
+		}
+	}
+
+	std::vector<GLuint> indices;
+	for (int ring = 0; ring < RINGS; ring++) {
+		for (int segment = 0; segment < SEGMENTS; segment++) {
+			GLuint a = ring * (SEGMENTS + 1) + segment, b = a + SEGMENTS + 1;
+			GLuint quad[6] = { a, a + 1, b, b, a + 1, b + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	sphere_vbo = createObjectVBO(vertices.data(), GLsizei(vertices.size()));
+	sphere_ebo = createObjectEBO(indices.data(), GLsizei(indices.size()));
+	sphere_vao = createObjectVAO(sphere_vbo, sphere_ebo);
+	sphere_index_count = GLsizei(indices.size());
+}
+
+void initDeferred()
+{
+	albedo_texture = createTarget(GL_RGBA8);
+	normal_texture = createTarget(GL_RGBA16F);
+	position_texture = createTarget(GL_RGBA32F);
+	depth_texture = createTarget(GL_DEPTH_COMPONENT32F);
+	lighting_texture = createTarget(GL_RGBA16F);
+
+	const GLenum gbuffer_targets[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+	glCreateFramebuffers(1, &gbuffer_framebuffer);
+	glNamedFramebufferTexture(gbuffer_framebuffer, GL_COLOR_ATTACHMENT0, albedo_texture, 0);
+	glNamedFramebufferTexture(gbuffer_framebuffer, GL_COLOR_ATTACHMENT1, normal_texture, 0);
+	glNamedFramebufferTexture(gbuffer_framebuffer, GL_COLOR_ATTACHMENT2, position_texture, 0);
+	glNamedFramebufferTexture(gbuffer_framebuffer, GL_DEPTH_ATTACHMENT, depth_texture, 0);
+	glNamedFramebufferDrawBuffers(gbuffer_framebuffer, 3, gbuffer_targets);
+
+	glCreateFramebuffers(1, &lighting_framebuffer);
+	glNamedFramebufferTexture(lighting_framebuffer, GL_COLOR_ATTACHMENT0, lighting_texture, 0);
+	glNamedFramebufferTexture(lighting_framebuffer, GL_DEPTH_ATTACHMENT, depth_texture, 0);
+
+	if (glCheckNamedFramebufferStatus(gbuffer_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE ||
+	    glCheckNamedFramebufferStatus(lighting_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw "ERROR::DEFERRED::Framebuffer incomplete.";
+	}
+
+	light_program = createProgram("shaders/light_volume.vert", "shaders/deferred_light.frag", LIGHTING_DEFINE);
+	unlit_program = createProgram("shaders/fullscreen.vert", "shaders/deferred_unlit.frag");
+	createLightVolume();
+	glCreateVertexArrays(1, &empty_vao);
+}
+
+bool deferredShading()
+{
+	return deferred_enabled;
+}
+
+void setDeferredShading(bool enabled)
+{
+	deferred_enabled = enabled;
+}
+
+void beginGBufferPass()
+{
+	frame_stats.lights = lightCount();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, gbuffer_framebuffer);
+	glDisable(GL_BLEND);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void executeLightingPass()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, lighting_framebuffer);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glDepthMask(GL_FALSE);
+
+	GLuint gbuffer[3] = { albedo_texture, normal_texture, position_texture };
+	glBindTextures(0, 3, gbuffer);
+
+	// unlit surfaces, once per pixel
+	glDisable(GL_DEPTH_TEST);
+	glUseProgram(unlit_program);
+	glBindVertexArray(empty_vao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glEnable(GL_DEPTH_TEST);
+
+	// back faces of the volumes behind the surface, also correct with the camera inside a volume
+	glCullFace(GL_FRONT);
+	glDepthFunc(GL_GEQUAL);
+	glUseProgram(light_program);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, lightBuffer());
+	glBindVertexArray(sphere_vao);
+	glDrawElementsInstanced(GL_TRIANGLES, sphere_index_count, GL_UNSIGNED_INT, NULL, lightCount());
+	frame_stats.draw_calls += 2;
+
+	glCullFace(GL_BACK);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void endDeferredFrame()
+{
+	glBlitNamedFramebuffer(lighting_framebuffer, sceneFramebuffer(), 0, 0, WIDTH, HEIGHT, 0, 0, WIDTH, HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer());
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== DEFERRED SHADING ==================== */
+
+// The opaque pass writes albedo, normal + shininess and world position into a G-buffer. Every light
+// then draws its bounding sphere (one instanced draw for all lights) with front-face culling and a
+// GL_GEQUAL test against the G-buffer depth, so a light only shades the pixels inside its volume.
+// Unlit surfaces (shininess < 0) are copied by one full-screen pass. Skybox and blended geometry are
+// drawn forward into the lighting target, which shares the G-buffer depth, and the result is
+// blitted to the default framebuffer.
+
+// needs a GL context and initLights()
+void initDeferred();
+
+bool deferredShading();
+
+void setDeferredShading(bool enabled);
+
+// binds and clears the G-buffer, blending off, execute the opaque pass with RENDER_GBUFFER next
+void beginGBufferPass();
+
+// accumulates all lights, leaves the lighting target bound with the default blend/depth state
+void executeLightingPass();
+
+// copies the lighting target to the default framebuffer
+void endDeferredFrame();
@@ -0,0 +1,27 @@
+#include "frame_clock.hpp"
+#include <chrono>
+#include <algorithm>
+
+static std::chrono::steady_clock::time_point last_tick = std::chrono::steady_clock::now();
+static double accumulator = 0.0;
+
+FrameTiming tickFrameClock()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	FrameTiming timing;
+	timing.frame_seconds = std::chrono::duration<double>(now - last_tick).count();
+	last_tick = now;
+
+	// after a stall the simulation falls behind instead of running a burst of steps
+	accumulator += std::min(timing.frame_seconds, MAX_FRAME_TIME);
+	timing.steps = int(accumulator / SIMULATION_STEP);
+	accumulator -= timing.steps * SIMULATION_STEP;
+	timing.alpha = float(accumulator / SIMULATION_STEP);
+	return timing;
+}
+
+void resetFrameClock()
+{
+	last_tick = std::chrono::steady_clock::now();
+	accumulator = 0.0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== FRAME CLOCK ==================== */
+
+// Wall time of the render loop split into fixed simulation steps. Every frame adds the time since
+// the previous one, clamped to MAX_FRAME_TIME, to an accumulator and takes whole SIMULATION_STEP
+// steps out of it. The remainder is the interpolation factor between the last two simulated
+// states, so what moves on screen moves at the same speed at any frame rate.
+
+struct FrameTiming {
+    int steps;            // simulation steps to take this frame
+    float alpha;          // 0..1 from the state before the last step to the last one
+    double frame_seconds; // wall time since the previous frame, unclamped
+};
+
+// called once per frame
+FrameTiming tickFrameClock();
+
+// drops the time since the last tick, after loading or a benchmark setup
+void resetFrameClock();
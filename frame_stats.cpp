@@ -0,0 +1,111 @@
+#include "application.hpp"
+#include "frame_stats.hpp"
+#include "gpu_profiler.hpp"
+#include <cstring>
+#include <algorithm>
+
+FrameStats frame_stats;
+
+static long frame_number = 0;
+static double submit_ms_total = 0.0;
+static double cull_ms_total = 0.0;
+static double frame_ms_total = 0.0;
+static int steps_total = 0;
+
+static GLuint samples_queries[UNIFORM_RING_FRAMES];
+static bool samples_query_pending[UNIFORM_RING_FRAMES];
+static int samples_query_index = 0;
+static GLuint64 last_shaded_samples = 0;
+
+void resetFrameStats()
+{
+	std::memset(&frame_stats, 0, sizeof(frame_stats));
+}
+
+void beginShadedSamplesQuery()
+{
+	if (!samples_queries[0]) {
+		glCreateQueries(GL_SAMPLES_PASSED, UNIFORM_RING_FRAMES, samples_queries);
+	}
+
+	// result of the frame that used this query last, kept if the GPU is not there yet
+	GLuint query = samples_queries[samples_query_index];
+	if (samples_query_pending[samples_query_index]) {
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &last_shaded_samples);
+		}
+	}
+	frame_stats.shaded_samples = last_shaded_samples;
+	glBeginQuery(GL_SAMPLES_PASSED, query);
+}
+
+void endShadedSamplesQuery()
+{
+	glEndQuery(GL_SAMPLES_PASSED);
+	samples_query_pending[samples_query_index] = true;
+	samples_query_index = (samples_query_index + 1) % UNIFORM_RING_FRAMES;
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	return sorted[std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5))];
+}
+
+TimeSummary summarizeTimes(std::vector<double> times)
+{
+	TimeSummary summary = TimeSummary();
+	if (times.empty()) { return summary; }
+
+	std::sort(times.begin(), times.end());
+	double sum = 0.0;
+	for (size_t i = 0; i < times.size(); i++) { sum += times[i]; }
+	summary.min = times.front();
+	summary.avg = sum / times.size();
+	summary.p50 = percentile(times, 0.50);
+	summary.p95 = percentile(times, 0.95);
+	summary.p99 = percentile(times, 0.99);
+	summary.max = times.back();
+	return summary;
+}
+
+void logFrameStats()
+{
+	frame_number++;
+	submit_ms_total += frame_stats.submit_ms;
+	cull_ms_total += frame_stats.cull_ms;
+	frame_ms_total += frame_stats.frame_ms;
+	steps_total += frame_stats.simulation_steps;
+	if (FRAME_STATS_INTERVAL <= 0 || frame_number % FRAME_STATS_INTERVAL != 0) { return; }
+
+	double frame_ms = frame_ms_total / FRAME_STATS_INTERVAL;
+	std::printf("frame %ld: %.3f ms (%.0f fps), %d simulation steps\n", frame_number, frame_ms, 1000.0 / frame_ms, steps_total);
+	std::printf("  %d draws (%d indirect commands), %d state changes, %d saved\n",
+		frame_stats.draw_calls, frame_stats.indirect_commands, frame_stats.state_changes, frame_stats.state_changes_saved);
+	std::printf("  culling: gpu %d visible %d culled %d occluded, cpu %d visible %d culled in %.4f ms, submit %.4f ms\n",
+		frame_stats.objects_visible, frame_stats.objects_culled, frame_stats.objects_occluded, frame_stats.cpu_visible, frame_stats.cpu_culled,
+		cull_ms_total / FRAME_STATS_INTERVAL, submit_ms_total / FRAME_STATS_INTERVAL);
+	if (frame_stats.cluster_lights) {
+		std::printf("  clustered: %d lights binned in %.3f ms\n", frame_stats.cluster_lights, gpuPassAverage(GPU_PASS_CLUSTERS));
+	}
+	if (frame_stats.lights) {
+		std::printf("  deferred: %d lights, gbuffer %.3f ms, lighting %.3f ms\n", frame_stats.lights,
+			gpuPassAverage(GPU_PASS_GBUFFER), gpuPassAverage(GPU_PASS_LIGHTING));
+	}
+	else {
+		std::printf("  opaque pass: %.2f shaded samples per pixel\n", double(frame_stats.shaded_samples) / (WIDTH * HEIGHT));
+	}
+	if (GPU_PASS_TIMERS) {
+		std::printf("  gpu ms over %d frames:", GPU_TIMING_WINDOW);
+		for (int p = 0; p < GPU_PASS_COUNT; p++) {
+			double ms = gpuPassAverage(GpuPass(p));
+			if (ms > 0.0) { std::printf(" %s %.3f", gpuPassName(GpuPass(p)), ms); }
+		}
+		std::printf("\n");
+	}
+	submit_ms_total = 0.0;
+	cull_ms_total = 0.0;
+	frame_ms_total = 0.0;
+	steps_total = 0;
+}
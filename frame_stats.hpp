@@ -0,0 +1,43 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== FRAME STATISTICS ==================== */
+
+// counters of the current frame, reset at the start of draw()
+struct FrameStats {
+    double frame_ms;         // wall time since the previous frame
+    int simulation_steps;    // fixed steps taken for it
+    int draw_calls;          // glDraw* and glMultiDraw* calls
+    int indirect_commands;   // meshes drawn by multi-draw calls
+    int state_changes;       // program, VAO, texture and buffer binds issued
+    int state_changes_saved; // binds skipped because the state was already set
+    int objects_visible;     // static scene commands passing GPU frustum culling, a few frames late
+    int objects_culled;
+    int objects_occluded;    // rejected by the Hi-Z test
+    int cpu_visible;         // boxes passing CPU frustum culling
+    int cpu_culled;
+    double cull_ms;          // CPU culling time, part of submit_ms
+    double submit_ms;        // CPU time spent submitting and issuing the opaque pass
+    GLuint64 shaded_samples; // samples passing the depth test in the opaque shading pass, a few frames late
+    int lights;              // deferred shading only, 0 = forward frame
+    int cluster_lights;      // lights binned by the clustered path, 0 = not used this frame
+};
+
+extern FrameStats frame_stats;
+
+void resetFrameStats();
+
+// GL_SAMPLES_PASSED around the opaque shading pass, one query per frame in flight
+void beginShadedSamplesQuery();
+void endShadedSamplesQuery();
+
+// distribution of per-frame times, for the benchmarks
+struct TimeSummary {
+    double min, avg, p50, p95, p99, max;
+};
+
+// summary of times in ms, all zero for an empty list
+TimeSummary summarizeTimes(std::vector<double> times);
+
+// prints the counters every FRAME_STATS_INTERVAL frames, times averaged over the interval
+void logFrameStats();
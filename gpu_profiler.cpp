@@ -0,0 +1,114 @@
+#include "gpu_profiler.hpp"
+
+// elapsed time of every pass, per frame in flight
+static GLuint pass_queries[UNIFORM_RING_FRAMES][GPU_PASS_COUNT];
+static bool pass_used[UNIFORM_RING_FRAMES][GPU_PASS_COUNT];
+static bool frame_pending[UNIFORM_RING_FRAMES];
+static int frame_index = 0;
+
+// last read back frame
+static double last_ms[GPU_PASS_COUNT];
+static bool last_ran[GPU_PASS_COUNT];
+static long readback_serial = 0;
+
+// rolling window of read back frames, a pass that did not run adds no sample
+static double window_ms[GPU_TIMING_WINDOW][GPU_PASS_COUNT];
+static bool window_ran[GPU_TIMING_WINDOW][GPU_PASS_COUNT];
+static int window_index = 0;
+static double window_sum[GPU_PASS_COUNT];
+static int window_count[GPU_PASS_COUNT];
+
+static const char* pass_names[GPU_PASS_COUNT] = {
+	"occluders", "culling", "clusters", "gbuffer", "lighting", "depth", "opaque", "skybox", "blended"
+};
+
+static void addWindowSample()
+{
+	for (int p = 0; p < GPU_PASS_COUNT; p++) {
+		if (window_ran[window_index][p]) {
+			window_sum[p] -= window_ms[window_index][p];
+			window_count[p]--;
+		}
+		window_ms[window_index][p] = last_ms[p];
+		window_ran[window_index][p] = last_ran[p];
+		if (last_ran[p]) {
+			window_sum[p] += last_ms[p];
+			window_count[p]++;
+		}
+	}
+	window_index = (window_index + 1) % GPU_TIMING_WINDOW;
+}
+
+// results of the frame that used this slot, dropped if the GPU is not there yet
+static void readFrame(int slot)
+{
+	for (int p = 0; p < GPU_PASS_COUNT; p++) {
+		if (!pass_used[slot][p]) { continue; }
+		GLint available = 0;
+		glGetQueryObjectiv(pass_queries[slot][p], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) { return; }
+	}
+
+	for (int p = 0; p < GPU_PASS_COUNT; p++) {
+		last_ran[p] = pass_used[slot][p];
+		last_ms[p] = 0.0;
+		if (!last_ran[p]) { continue; }
+		GLuint64 elapsed_ns = 0;
+		glGetQueryObjectui64v(pass_queries[slot][p], GL_QUERY_RESULT, &elapsed_ns);
+		last_ms[p] = elapsed_ns / 1e6;
+	}
+	readback_serial++;
+	addWindowSample();
+}
+
+void beginGpuFrame()
+{
+	if (!GPU_PASS_TIMERS) { return; }
+	if (!pass_queries[0][0]) {
+		glCreateQueries(GL_TIME_ELAPSED, UNIFORM_RING_FRAMES * GPU_PASS_COUNT, &pass_queries[0][0]);
+	}
+
+	if (frame_pending[frame_index]) { readFrame(frame_index); }
+	for (int p = 0; p < GPU_PASS_COUNT; p++) { pass_used[frame_index][p] = false; }
+}
+
+void endGpuFrame()
+{
+	if (!GPU_PASS_TIMERS) { return; }
+	frame_pending[frame_index] = true;
+	frame_index = (frame_index + 1) % UNIFORM_RING_FRAMES;
+}
+
+GpuScope::GpuScope(GpuPass pass) : pass(pass)
+{
+	if (!GPU_PASS_TIMERS || pass_used[frame_index][pass]) { return; }
+	glBeginQuery(GL_TIME_ELAPSED, pass_queries[frame_index][pass]);
+}
+
+GpuScope::~GpuScope()
+{
+	if (!GPU_PASS_TIMERS || pass_used[frame_index][pass]) { return; }
+	glEndQuery(GL_TIME_ELAPSED);
+	pass_used[frame_index][pass] = true;
+}
+
+const char* gpuPassName(GpuPass pass)
+{
+	return pass_names[pass];
+}
+
+bool gpuPassTime(GpuPass pass, double& ms)
+{
+	ms = last_ms[pass];
+	return last_ran[pass];
+}
+
+long gpuReadbackSerial()
+{
+	return readback_serial;
+}
+
+double gpuPassAverage(GpuPass pass)
+{
+	return window_count[pass] ? window_sum[pass] / window_count[pass] : 0.0;
+}
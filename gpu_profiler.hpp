@@ -0,0 +1,49 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== GPU PASS TIMERS ==================== */
+
+// Every pass of draw() runs inside a GpuScope, a GL_TIME_ELAPSED query around it. Only one such
+// query can be active, so scopes do not nest. There is one set of queries per frame in flight, the
+// results of a set are read when draw() comes back to it UNIFORM_RING_FRAMES frames later, so the
+// CPU never waits for them.
+
+enum GpuPass {
+    GPU_PASS_OCCLUDERS,  // walls and pillar depth, Hi-Z pyramid
+    GPU_PASS_CULLING,    // static scene culling compute pass
+    GPU_PASS_CLUSTERS,   // light binning
+    GPU_PASS_GBUFFER,
+    GPU_PASS_LIGHTING,   // light volumes
+    GPU_PASS_DEPTH,      // depth pre-pass
+    GPU_PASS_OPAQUE,     // floor, models and chairs, shaded
+    GPU_PASS_SKYBOX,
+    GPU_PASS_BLENDED,    // windows
+    GPU_PASS_COUNT
+};
+
+// reads the results of the oldest frame in flight, called at the start of draw()
+void beginGpuFrame();
+
+void endGpuFrame();
+
+// times one pass, at most once per frame, not inside another scope
+class GpuScope {
+public:
+    explicit GpuScope(GpuPass pass);
+    ~GpuScope();
+
+private:
+    GpuPass pass;
+};
+
+const char* gpuPassName(GpuPass pass);
+
+// pass time of the last frame read back, false if the pass did not run in it
+bool gpuPassTime(GpuPass pass, double& ms);
+
+// frames read back so far, gpuPassTime() has a new frame only when this changed, a frame whose
+// queries are not available yet is skipped and the previous results stay
+long gpuReadbackSerial();
+
+// average over the frames of the last GPU_TIMING_WINDOW that ran the pass, 0 if none did
+double gpuPassAverage(GpuPass pass);
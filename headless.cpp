@@ -0,0 +1,150 @@
+#include "headless.hpp"
+#include "frame_stats.hpp"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#include <chrono>
+
+// frames before timing starts, textures stream in and the uniform ring fills
+static const int HEADLESS_WARMUP_FRAMES = 30;
+
+static EGLDisplay display = EGL_NO_DISPLAY;
+static EGLContext context = EGL_NO_CONTEXT;
+static GLuint offscreen_framebuffer, offscreen_color, offscreen_depth;
+
+// surfaceless platform first, it needs neither a display server nor a DRM device
+static EGLDisplay openDisplay()
+{
+	const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay) {
+		EGLDisplay surfaceless = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (surfaceless != EGL_NO_DISPLAY) { return surfaceless; }
+	}
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool createHeadlessContext()
+{
+	display = openDisplay();
+	EGLint major = 0, minor = 0;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+		std::printf("headless: no EGL display\n");
+		return false;
+	}
+
+	const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (!extensions || !std::strstr(extensions, "EGL_KHR_surfaceless_context")) {
+		std::printf("headless: EGL %d.%d without EGL_KHR_surfaceless_context\n", major, minor);
+		eglTerminate(display);
+		return false;
+	}
+
+	// the context never draws to a surface, any config with desktop GL does
+	const EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, 0,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config = NULL;
+	EGLint config_count = 0;
+	if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0) {
+		config = NULL; // EGL_NO_CONFIG_KHR, accepted by Mesa
+	}
+
+	const EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	if (!eglBindAPI(EGL_OPENGL_API) ||
+		(context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes)) == EGL_NO_CONTEXT ||
+		!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		std::printf("headless: no OpenGL 4.5 core context (EGL error 0x%x)\n", eglGetError());
+		destroyHeadlessContext();
+		return false;
+	}
+
+	std::printf("headless: EGL %d.%d, %s\n", major, minor, eglQueryString(display, EGL_VENDOR));
+	return true;
+}
+
+void destroyHeadlessContext()
+{
+	if (display == EGL_NO_DISPLAY) { return; }
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != EGL_NO_CONTEXT) { eglDestroyContext(display, context); }
+	eglTerminate(display);
+	context = EGL_NO_CONTEXT;
+	display = EGL_NO_DISPLAY;
+}
+
+void createOffscreenTarget()
+{
+	glCreateRenderbuffers(1, &offscreen_color);
+	glNamedRenderbufferStorage(offscreen_color, GL_RGBA8, WIDTH, HEIGHT);
+	glCreateRenderbuffers(1, &offscreen_depth);
+	glNamedRenderbufferStorage(offscreen_depth, GL_DEPTH_COMPONENT24, WIDTH, HEIGHT);
+
+	glCreateFramebuffers(1, &offscreen_framebuffer);
+	glNamedFramebufferRenderbuffer(offscreen_framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreen_color);
+	glNamedFramebufferRenderbuffer(offscreen_framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, offscreen_depth);
+	if (glCheckNamedFramebufferStatus(offscreen_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw "ERROR::HEADLESS::Offscreen framebuffer incomplete.";
+	}
+	setSceneFramebuffer(offscreen_framebuffer);
+	glViewport(0, 0, WIDTH, HEIGHT);
+}
+
+void destroyOffscreenTarget()
+{
+	setSceneFramebuffer(0);
+	glDeleteFramebuffers(1, &offscreen_framebuffer);
+	glDeleteRenderbuffers(1, &offscreen_color);
+	glDeleteRenderbuffers(1, &offscreen_depth);
+	offscreen_framebuffer = offscreen_color = offscreen_depth = 0;
+}
+
+static void renderHeadlessFrame()
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	draw();
+	glFlush();
+}
+
+int runHeadless(int frame_count)
+{
+	if (frame_count <= 0) {
+		std::printf("headless: frame count must be positive\n");
+		return 1;
+	}
+	createOffscreenTarget();
+
+	for (int i = 0; i < HEADLESS_WARMUP_FRAMES; i++) { renderHeadlessFrame(); }
+	glFinish();
+
+	// CPU time per frame, the uniform ring fences keep it within UNIFORM_RING_FRAMES of the GPU
+	std::vector<double> frame_ms(frame_count);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point frame_start = start;
+	for (int i = 0; i < frame_count; i++) {
+		renderHeadlessFrame();
+		std::chrono::steady_clock::time_point frame_end = std::chrono::steady_clock::now();
+		frame_ms[i] = std::chrono::duration<double, std::milli>(frame_end - frame_start).count();
+		frame_start = frame_end;
+	}
+	glFinish();
+	double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	TimeSummary cpu = summarizeTimes(frame_ms);
+
+	std::printf("headless: %d frames at %dx%d on %s\n", frame_count, WIDTH, HEIGHT, (const char*)glGetString(GL_RENDERER));
+	std::printf("%-10s %10s %10s %10s %10s %10s\n", "frame ms", "min", "avg", "p50", "p95", "max");
+	std::printf("%-10s %10.3f %10.3f %10.3f %10.3f %10.3f\n", "cpu", cpu.min, cpu.avg, cpu.p50, cpu.p95, cpu.max);
+	std::printf("total %.1f ms including the final glFinish, %.1f frames/s\n", total_ms, frame_count * 1000.0 / total_ms);
+
+	destroyOffscreenTarget();
+	return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== HEADLESS RENDERING ==================== */
+
+// An EGL context without any surface (Mesa's surfaceless platform, llvmpipe when there is no GPU)
+// stands in for the GLFW window. Frames are drawn into an offscreen framebuffer of the window size,
+// nothing is presented, so frame times can be tracked on servers without a display.
+
+// OpenGL 4.5 core context made current on this thread, false after printing why there is none
+bool createHeadlessContext();
+
+void destroyHeadlessContext();
+
+// offscreen framebuffer of the window size made the scene framebuffer, a surfaceless context has
+// no default framebuffer
+void createOffscreenTarget();
+
+void destroyOffscreenTarget();
+
+// renders warm-up frames, then frame_count timed frames into the offscreen framebuffer and prints
+// CPU frame time statistics and the throughput, needs init()
+int runHeadless(int frame_count);
@@ -0,0 +1,72 @@
+#include "hiz.hpp"
+#include <algorithm>
+
+static GLuint occluder_framebuffer, occluder_depth, hiz_pyramid;
+static GLuint occluder_program, downsample_program;
+static int pyramid_levels;
+
+static int levelSize(int size, int level)
+{
+	return std::max(1, size >> level);
+}
+
+void initHiZ()
+{
+	occluder_program = createProgram("shaders/default.vert", "shaders/depth.frag");
+	downsample_program = createComputeProgram("shaders/hiz_downsample.comp");
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &occluder_depth);
+	glTextureStorage2D(occluder_depth, 1, GL_DEPTH_COMPONENT32F, HIZ_WIDTH, HIZ_HEIGHT);
+
+	glCreateFramebuffers(1, &occluder_framebuffer);
+	glNamedFramebufferTexture(occluder_framebuffer, GL_DEPTH_ATTACHMENT, occluder_depth, 0);
+	glNamedFramebufferDrawBuffer(occluder_framebuffer, GL_NONE);
+	if (glCheckNamedFramebufferStatus(occluder_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw "ERROR::HIZ::Occluder framebuffer incomplete.";
+	}
+
+	// level 0 = half the occluder resolution, down to 1x1
+	int width = levelSize(HIZ_WIDTH, 1), height = levelSize(HIZ_HEIGHT, 1);
+	pyramid_levels = int(std::log2(std::max(width, height))) + 1;
+	glCreateTextures(GL_TEXTURE_2D, 1, &hiz_pyramid);
+	glTextureStorage2D(hiz_pyramid, pyramid_levels, GL_R32F, width, height);
+	glTextureParameteri(hiz_pyramid, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTextureParameteri(hiz_pyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+void beginOccluderPass()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, occluder_framebuffer);
+	glViewport(0, 0, HIZ_WIDTH, HIZ_HEIGHT);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glUseProgram(occluder_program);
+}
+
+void buildHiZ()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer());
+	glViewport(0, 0, WIDTH, HEIGHT);
+
+	// every level is the farthest depth of a 2x2 (up to 3x3 at odd edges) block of the one above,
+	// the occluder depth texture being the one above level 0
+	glUseProgram(downsample_program);
+	for (int level = 0; level < pyramid_levels; level++) {
+		GLuint source = level == 0 ? occluder_depth : hiz_pyramid;
+		int source_level = level == 0 ? 0 : level - 1;
+		int source_width = level == 0 ? HIZ_WIDTH : levelSize(HIZ_WIDTH, level);
+		int source_height = level == 0 ? HIZ_HEIGHT : levelSize(HIZ_HEIGHT, level);
+		int width = levelSize(HIZ_WIDTH, level + 1), height = levelSize(HIZ_HEIGHT, level + 1);
+
+		glBindTextureUnit(0, source);
+		glBindImageTexture(0, hiz_pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glUniform1i(0, source_level);
+		glUniform2i(1, source_width, source_height);
+		glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+}
+
+GLuint hiZTexture()
+{
+	return hiz_pyramid;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== HIERARCHICAL Z ==================== */
+
+// Large occluders are rendered depth-only into an HIZ_WIDTH x HIZ_HEIGHT depth texture, which is
+// reduced into a mip pyramid of farthest depths by a compute shader. Level 0 of the pyramid is half
+// the occluder resolution, every level halves again. The static scene culling pass rejects draws
+// whose nearest depth lies behind the pyramid over their screen rectangle.
+
+// needs a GL context
+void initHiZ();
+
+// binds the occluder framebuffer and the depth-only program, the caller draws the occluders
+// with the camera and model uniforms bound as usual
+void beginOccluderPass();
+
+// restores the default framebuffer and builds the pyramid
+void buildHiZ();
+
+GLuint hiZTexture();
@@ -0,0 +1,91 @@
+#include "lights.hpp"
+#include <algorithm>
+
+// attenuation of the main light, same coefficients as texture.frag
+static const float CONSTANT = 0.5f;
+static const float LINEAR = -0.1f;
+static const float QUADRATIC = 0.04f;
+// the light volume ends where attenuation drops below this
+static const float ATTENUATION_CUTOFF = 1.0f / 64.0f;
+
+// lot spotlights, a grid over the floor
+static const float LOT_LIGHT_HEIGHT = 4.0f;
+static const float LOT_LIGHT_RADIUS = 6.0f;
+static const float LOT_AREA_MIN_X = -5.5f, LOT_AREA_MAX_X = 5.5f;
+static const float LOT_AREA_MIN_Z = -4.0f, LOT_AREA_MAX_Z = 5.5f;
+
+static GLuint light_buffer = 0;
+static std::vector<Light> lights;
+static glm::vec3 main_light_position, spotlight_position, spotlight_direction;
+
+static Light pointLight(const glm::vec3& position)
+{
+	// 1 / (c + l*d + q*d^2) = cutoff, larger root
+	float c = CONSTANT - 1.0f / ATTENUATION_CUTOFF;
+	float radius = (-LINEAR + std::sqrt(LINEAR * LINEAR - 4.0f * QUADRATIC * c)) / (2.0f * QUADRATIC);
+
+	Light light;
+	light.position = glm::vec4(position, radius);
+	light.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	light.direction = glm::vec4(0.0f);
+	light.params = glm::vec4(float(LIGHT_POINT), 0.0f, 0.0f, 0.0f);
+	return light;
+}
+
+static Light spotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color,
+                       float intensity, float radius, float inner_angle, float outer_angle)
+{
+	Light light;
+	light.position = glm::vec4(position, radius);
+	light.color = glm::vec4(color, intensity);
+	light.direction = glm::vec4(glm::normalize(direction), 0.0f);
+	light.params = glm::vec4(float(LIGHT_SPOT), inner_angle, outer_angle, 0.0f);
+	return light;
+}
+
+static void buildLights(int count)
+{
+	lights.clear();
+	lights.push_back(pointLight(main_light_position));
+	lights.push_back(spotLight(spotlight_position, spotlight_direction, glm::vec3(1.0f), 0.8f, 10.0f, 0.94f, 0.96f));
+
+	// warm and cold whites alternating over a square grid
+	int lot_lights = count - int(lights.size());
+	int side = int(std::ceil(std::sqrt(float(std::max(lot_lights, 1)))));
+	for (int i = 0; i < lot_lights; i++) {
+		float u = (i % side + 0.5f) / side;
+		float v = (i / side + 0.5f) / side;
+		glm::vec3 position(LOT_AREA_MIN_X + u * (LOT_AREA_MAX_X - LOT_AREA_MIN_X), LOT_LIGHT_HEIGHT,
+		                   LOT_AREA_MIN_Z + v * (LOT_AREA_MAX_Z - LOT_AREA_MIN_Z));
+		glm::vec3 color = i % 2 ? glm::vec3(1.0f, 0.85f, 0.6f) : glm::vec3(0.8f, 0.9f, 1.0f);
+		lights.push_back(spotLight(position, glm::vec3(0.0f, -1.0f, 0.0f), color, 0.5f, LOT_LIGHT_RADIUS, 0.85f, 0.9f));
+	}
+	lights.resize(count);
+}
+
+void initLights(const glm::vec3& main_light, const glm::vec3& spotlight, const glm::vec3& direction, int count)
+{
+	main_light_position = main_light;
+	spotlight_position = spotlight;
+	spotlight_direction = direction;
+
+	glCreateBuffers(1, &light_buffer);
+	glNamedBufferStorage(light_buffer, MAX_LIGHTS * sizeof(Light), NULL, GL_DYNAMIC_STORAGE_BIT);
+	setLightCount(count);
+}
+
+void setLightCount(int count)
+{
+	buildLights(std::min(std::max(count, 1), MAX_LIGHTS));
+	glNamedBufferSubData(light_buffer, 0, lights.size() * sizeof(Light), lights.data());
+}
+
+int lightCount()
+{
+	return int(lights.size());
+}
+
+GLuint lightBuffer()
+{
+	return light_buffer;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== LIGHTS ==================== */
+
+// All scene lights in one std430 SSBO at binding 4, read by the deferred and clustered paths.
+// Light 0 is the hall's point light, light 1 the train spotlight, the rest are spotlights over
+// the lots. The forward shaders keep their fixed two-light uniforms.
+
+const int LIGHT_POINT = 0;
+const int LIGHT_SPOT = 1;
+
+struct Light {
+    glm::vec4 position;  // xyz, w = radius of influence
+    glm::vec4 color;     // rgb, a = intensity
+    glm::vec4 direction; // xyz = spot direction
+    glm::vec4 params;    // x = LIGHT_POINT/LIGHT_SPOT, y/z = spot inner/outer angle cosines as in texture.frag
+};
+
+// creates the SSBO for MAX_LIGHTS lights and uploads the first count, needs a GL context
+void initLights(const glm::vec3& main_light, const glm::vec3& spotlight, const glm::vec3& spotlight_direction, int count);
+
+// rebuilds the setup with count lights, clamped to 1..MAX_LIGHTS
+void setLightCount(int count);
+
+int lightCount();
+
+GLuint lightBuffer();
@@ -1,7 +1,95 @@
 #include "application.hpp"
+#include "benchmark.hpp"
+#include "mesh_cache.hpp"
+#include "shader_reload.hpp"
+#include "headless.hpp"
+#include "trace.hpp"
+#include <chrono>
+#include <cstdlib>
 
-int main(void)
+// state shared by the window and the headless context
+static void setupGLState()
 {
+    glEnable(GL_MULTISAMPLE);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+// camera path benchmark, --bench-path <file> [frames] [--json <file>]
+struct PathOptions {
+    const char* path_file; // NULL = no path benchmark
+    int frames;
+    const char* json_file;
+};
+
+// offscreen frames without GLFW, for machines without a display
+static int runHeadlessMode(int frame_count, const PathOptions& path)
+{
+    if (!createHeadlessContext())
+        return 1;
+
+    /* GLEW reports the missing GLX display, the GL entry points are loaded before that check */
+    GLenum err = glewInit();
+    if (GLEW_OK != err && GLEW_ERROR_NO_GLX_DISPLAY != err)
+    {
+        std::cout << "Error: " << glewGetErrorString(err) << std::endl;
+        destroyHeadlessContext();
+        return 1;
+    }
+
+    setupGLState();
+    init();
+    int result;
+    if (path.path_file)
+    {
+        createOffscreenTarget();
+        result = benchmarkCameraPath(NULL, path.path_file, path.frames, path.json_file);
+        destroyOffscreenTarget();
+    }
+    else
+    {
+        result = runHeadless(frame_count);
+    }
+    stopShaderWatcher();
+    destroyHeadlessContext();
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    traceThreadName("main");
+
+    /* tools and benchmarks without a window */
+    bool bench_lights = false, bench_clustered = false, headless = false;
+    int headless_frames = HEADLESS_FRAMES;
+    PathOptions path = { NULL, 0, NULL };
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--bench-lights") { bench_lights = true; }
+        if (std::string(argv[i]) == "--bench-clustered") { bench_clustered = true; }
+        if (std::string(argv[i]) == "--bench-obj") { return benchmarkOBJLoader(); }
+        if (std::string(argv[i]) == "--build-mesh-cache") { return buildMeshCache(); }
+        if (std::string(argv[i]) == "--bench-culling") { return benchmarkCulling(); }
+        if (std::string(argv[i]) == "--headless")
+        {
+            headless = true;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) { headless_frames = std::atoi(argv[++i]); }
+        }
+        if (std::string(argv[i]) == "--bench-path" && i + 1 < argc)
+        {
+            path.path_file = argv[++i];
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0) { path.frames = std::atoi(argv[++i]); }
+        }
+        if (std::string(argv[i]) == "--json" && i + 1 < argc) { path.json_file = argv[++i]; }
+    }
+    if (headless)
+        return runHeadlessMode(headless_frames, path);
+
     GLFWwindow* window;
 
     /* Initialize the library */
@@ -21,6 +109,7 @@ int main(void)
 
     /* Make the window's context current */
     glfwMakeContextCurrent(window);
+    glfwSwapInterval(VSYNC ? 1 : 0);
 
     /* link opengl functions with GLEW */
     GLenum err = glewInit();
@@ -38,28 +127,44 @@ int main(void)
 
     /* enabling things */
     glfwWindowHint(GLFW_SAMPLES, 4);
-    glEnable(GL_MULTISAMPLE);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    setupGLState();
     init();
+    if (bench_lights || bench_clustered || path.path_file)
+    {
+        int result = bench_lights ? benchmarkLights(window)
+                   : bench_clustered ? benchmarkClustered(window)
+                   : benchmarkCameraPath(window, path.path_file, path.frames, path.json_file);
+        stopShaderWatcher();
+        glfwTerminate();
+        return result;
+    }
 
     /* ================== RENDERING =====================*/
+    bool first_frame = true;
     while (!glfwWindowShouldClose(window))
     {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         draw();
-        glfwSwapBuffers(window);
+        {
+            TraceScope trace("swap buffers");
+            glfwSwapBuffers(window);
+        }
+
+        /* startup cost: window, init() and the first frame on screen */
+        if (first_frame)
+        {
+            glFinish();
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            std::printf("first frame after %.1f ms\n", elapsed.count());
+            first_frame = false;
+        }
         
         /* Poll for and process events */
+        TraceScope trace("poll events");
         glfwPollEvents();
     }
 
+    stopShaderWatcher();
     glfwTerminate();
     return 0;
 }
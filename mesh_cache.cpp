@@ -0,0 +1,195 @@
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include <cstring>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char     MESH_CACHE_MAGIC[4] = { 'A', 'H', 'M', 'C' };
+static const uint32_t MESH_CACHE_VERSION = 2;
+
+static int64_t modificationTime(const struct stat& info)
+{
+	return int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+// FNV-1a, 64 bit
+static uint64_t hashFile(const char* file_name)
+{
+	std::string content = getFileContent(file_name);
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < content.size(); i++) {
+		hash ^= (unsigned char)content[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+// obj/train.obj -> cache/train.mesh
+static std::string cachePath(const char* obj_file)
+{
+	std::string name = obj_file;
+	size_t slash = name.find_last_of('/');
+	if (slash != std::string::npos) { name = name.substr(slash + 1); }
+	size_t dot = name.find_last_of('.');
+	if (dot != std::string::npos) { name = name.substr(0, dot); }
+	return std::string(MESH_CACHE_DIR) + "/" + name + ".mesh";
+}
+
+// maps the cache file and validates it against the source OBJ
+static bool mapMeshCache(const std::string& cache_file, const char* obj_file, const struct stat& source, MeshData& data)
+{
+	int fd = open(cache_file.c_str(), O_RDONLY);
+	if (fd < 0) { return false; }
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(MeshCacheHeader)) {
+		close(fd);
+		return false;
+	}
+
+	size_t size = size_t(info.st_size);
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) { return false; }
+
+	MeshCacheHeader header;
+	std::memcpy(&header, mapping, sizeof(header));
+	size_t expected_size = sizeof(MeshCacheHeader) + size_t(header.vertex_count) * sizeof(Vertex)
+	                     + size_t(header.index_count) * sizeof(GLuint);
+
+	bool valid = std::memcmp(header.magic, MESH_CACHE_MAGIC, 4) == 0
+	          && header.version == MESH_CACHE_VERSION
+	          && header.vertex_size == sizeof(Vertex)
+	          && header.flags == (OPTIMIZE_MESHES ? MESH_CACHE_OPTIMIZED : 0)
+	          && expected_size == size
+	          && header.source_size == uint64_t(source.st_size);
+
+	// touched but identical sources only cost a hash, the header is refreshed so the next start skips it
+	if (valid && header.source_mtime != modificationTime(source)) {
+		valid = header.source_hash == hashFile(obj_file);
+		if (valid) {
+			header.source_mtime = modificationTime(source);
+			std::FILE* file = std::fopen(cache_file.c_str(), "r+b");
+			if (file) {
+				std::fwrite(&header, sizeof(header), 1, file);
+				std::fclose(file);
+			}
+		}
+	}
+
+	if (!valid) {
+		munmap(mapping, size);
+		return false;
+	}
+
+	data.mapping = mapping;
+	data.mapping_size = size;
+	data.vertex_offset = sizeof(MeshCacheHeader);
+	data.index_offset = data.vertex_offset + size_t(header.vertex_count) * sizeof(Vertex);
+	data.vertex_count = GLsizei(header.vertex_count);
+	data.index_count = GLsizei(header.index_count);
+	data.bounds_min = glm::vec3(header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]);
+	data.bounds_max = glm::vec3(header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]);
+	return true;
+}
+
+static void writeMeshCache(const std::string& cache_file, const char* obj_file, const struct stat& source, const MeshData& data)
+{
+	MeshCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MESH_CACHE_MAGIC, 4);
+	header.version = MESH_CACHE_VERSION;
+	header.vertex_size = sizeof(Vertex);
+	header.vertex_count = uint32_t(data.vertex_count);
+	header.index_count = uint32_t(data.index_count);
+	header.flags = OPTIMIZE_MESHES ? MESH_CACHE_OPTIMIZED : 0;
+	header.source_size = uint64_t(source.st_size);
+	header.source_mtime = modificationTime(source);
+	header.source_hash = hashFile(obj_file);
+	for (int i = 0; i < 3; i++) {
+		header.bounds_min[i] = data.bounds_min[i];
+		header.bounds_max[i] = data.bounds_max[i];
+	}
+
+	mkdir(MESH_CACHE_DIR, 0755);
+
+	// written next to the target and renamed, a crash never leaves a truncated cache behind
+	std::string temp_file = cache_file + ".tmp";
+	std::FILE* file = std::fopen(temp_file.c_str(), "wb");
+	if (!file) {
+		std::cout << "mesh cache: could not write " << temp_file << std::endl;
+		return;
+	}
+	bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+	            && std::fwrite(data.vertices(), sizeof(Vertex), data.vertex_count, file) == size_t(data.vertex_count)
+	            && std::fwrite(data.indices(), sizeof(GLuint), data.index_count, file) == size_t(data.index_count);
+	written = (std::fclose(file) == 0) && written;
+
+	if (!written || std::rename(temp_file.c_str(), cache_file.c_str()) != 0) {
+		std::remove(temp_file.c_str());
+		std::cout << "mesh cache: could not write " << cache_file << std::endl;
+	}
+}
+
+MeshData loadMeshData(const char* obj_file)
+{
+	struct stat source;
+	if (stat(obj_file, &source) != 0)
+	{
+		throw "ERROR::OBJLOADER::Could not open file.";
+	}
+
+	MeshData data;
+	std::string cache_file = cachePath(obj_file);
+	if (USE_MESH_CACHE && mapMeshCache(cache_file, obj_file, source, data)) {
+		std::ostringstream log;
+		log << "Nr of vertices: " << data.vertex_count << " unique of " << data.index_count << " corners\n";
+		log << obj_file << " loaded from cache!" << "\n";
+		std::cout << log.str();
+		return data;
+	}
+
+	data = loadOBJFile(obj_file);
+	if (OPTIMIZE_MESHES) {
+		optimizeMesh(data);
+	}
+
+	if (USE_MESH_CACHE) {
+		writeMeshCache(cache_file, obj_file, source, data);
+	}
+	return data;
+}
+
+void releaseMeshData(MeshData& data)
+{
+	if (data.mapping) {
+		munmap(const_cast<void*>(data.mapping), data.mapping_size);
+		data.mapping = NULL;
+		data.mapping_size = 0;
+	}
+	std::vector<Vertex>().swap(data.vertex_storage);
+	std::vector<GLuint>().swap(data.index_storage);
+	data.vertex_count = 0;
+	data.index_count = 0;
+}
+
+int buildMeshCache()
+{
+	std::vector<std::string> files = listFiles("obj", ".obj");
+	if (files.empty()) {
+		std::cout << "no OBJ files found, run from the repository root" << std::endl;
+		return 1;
+	}
+
+	for (size_t i = 0; i < files.size(); i++) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		MeshData data = loadMeshData(files[i].c_str());
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << files[i] << " -> " << cachePath(files[i].c_str()) << " (" << elapsed.count() << " ms)" << std::endl;
+		releaseMeshData(data);
+	}
+	return 0;
+}
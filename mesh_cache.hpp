@@ -0,0 +1,32 @@
+#pragma once
+#include "application.hpp"
+#include <stdint.h>
+
+/* ==================== MESH CACHE ==================== */
+
+// cache/<name>.mesh layout: header, Vertex array, optional GLuint index array
+struct MeshCacheHeader {
+    char     magic[4];      // "AHMC"
+    uint32_t version;
+    uint32_t vertex_size;   // sizeof(Vertex) of the writer
+    uint32_t vertex_count;
+    uint32_t index_count;   // 0 for non-indexed meshes
+    uint32_t flags;         // MESH_CACHE_* bits
+    uint64_t source_size;   // size, mtime and FNV-1a hash of the source OBJ
+    int64_t  source_mtime;  // in nanoseconds
+    uint64_t source_hash;
+    float    bounds_min[3];
+    float    bounds_max[3];
+};
+
+// mesh went through optimizeMesh
+const uint32_t MESH_CACHE_OPTIMIZED = 1;
+
+// loads obj_file through its binary cache, (re)building the cache when the OBJ changed, thread-safe
+MeshData loadMeshData(const char* obj_file);
+
+// unmaps a cache file mapping, parsed data is simply dropped
+void releaseMeshData(MeshData& data);
+
+// offline conversion of every obj/*.obj, used by --build-mesh-cache
+int buildMeshCache();
@@ -0,0 +1,203 @@
+#include "mesh_optimizer.hpp"
+#include <algorithm>
+
+VertexCacheStats analyzeVertexCache(const GLuint* indices, GLsizei index_count, GLsizei vertex_count)
+{
+	// FIFO cache, a vertex is a hit while fewer than VERTEX_CACHE_SIZE misses happened since it was loaded
+	std::vector<long> loaded_at(vertex_count, -VERTEX_CACHE_SIZE - 1);
+	long misses = 0;
+	for (GLsizei i = 0; i < index_count; i++) {
+		GLuint v = indices[i];
+		if (misses - loaded_at[v] > VERTEX_CACHE_SIZE) {
+			loaded_at[v] = misses;
+			misses++;
+		}
+	}
+
+	VertexCacheStats stats;
+	stats.acmr = index_count ? float(misses) / float(index_count / 3) : 0.0f;
+	stats.atvr = vertex_count ? float(misses) / float(vertex_count) : 0.0f;
+	return stats;
+}
+
+// next fanning vertex: the candidate that stays in cache and has the most live triangles
+static int nextVertex(const std::vector<int>& candidates, const std::vector<int>& cache_time, int timestamp,
+	const std::vector<int>& live, std::vector<int>& dead_end, int& cursor, int vertex_count, bool& hard_boundary)
+{
+	int best = -1, best_priority = -1;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		int v = candidates[i];
+		if (live[v] > 0) {
+			int priority = 0;
+			// still in cache after fanning it
+			if (timestamp - cache_time[v] + 2 * live[v] <= VERTEX_CACHE_SIZE) {
+				priority = timestamp - cache_time[v];
+			}
+			if (priority > best_priority) {
+				best_priority = priority;
+				best = v;
+			}
+		}
+	}
+	if (best != -1) { return best; }
+
+	// dead end, the next triangles start a new cluster
+	hard_boundary = true;
+	while (!dead_end.empty()) {
+		int v = dead_end.back();
+		dead_end.pop_back();
+		if (live[v] > 0) { return v; }
+	}
+	while (cursor < vertex_count) {
+		if (live[cursor] > 0) { return cursor; }
+		cursor++;
+	}
+	return -1;
+}
+
+// triangle order for the post-transform cache, cluster_starts receives the triangle offsets of hard boundaries
+static std::vector<GLuint> tipsify(const std::vector<GLuint>& indices, int vertex_count, std::vector<size_t>& cluster_starts)
+{
+	int triangle_count = int(indices.size() / 3);
+
+	// vertex -> triangle adjacency
+	std::vector<int> live(vertex_count, 0);
+	for (size_t i = 0; i < indices.size(); i++) { live[indices[i]]++; }
+	std::vector<int> offsets(vertex_count + 1, 0);
+	for (int v = 0; v < vertex_count; v++) { offsets[v + 1] = offsets[v] + live[v]; }
+	std::vector<int> adjacency(indices.size());
+	std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++) { adjacency[fill[indices[i]]++] = int(i / 3); }
+
+	std::vector<int> cache_time(vertex_count, 0);
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<int> dead_end;
+	std::vector<int> candidates;
+	std::vector<GLuint> result;
+	result.reserve(indices.size());
+
+	int timestamp = VERTEX_CACHE_SIZE + 1;
+	int cursor = 0;
+	int fanning = 0;
+	bool hard_boundary = true;
+	while (fanning >= 0) {
+		candidates.clear();
+		if (hard_boundary) {
+			cluster_starts.push_back(result.size() / 3);
+			hard_boundary = false;
+		}
+
+		for (int a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+			int t = adjacency[a];
+			if (emitted[t]) { continue; }
+			for (int c = 0; c < 3; c++) {
+				int v = int(indices[3 * t + c]);
+				result.push_back(GLuint(v));
+				dead_end.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (timestamp - cache_time[v] > VERTEX_CACHE_SIZE) {
+					cache_time[v] = timestamp++;
+				}
+			}
+			emitted[t] = true;
+		}
+		fanning = nextVertex(candidates, cache_time, timestamp, live, dead_end, cursor, vertex_count, hard_boundary);
+	}
+	return result;
+}
+
+struct Cluster {
+	size_t first, count; // in triangles
+	float occlusion;     // higher draws earlier
+};
+
+// clusters facing away from the mesh center occlude the rest and are drawn first (view-independent)
+static void sortClustersForOverdraw(std::vector<GLuint>& indices, const std::vector<size_t>& cluster_starts, const std::vector<Vertex>& vertices)
+{
+	size_t triangle_count = indices.size() / 3;
+	if (cluster_starts.size() < 2) { return; }
+
+	// area-weighted mesh centroid
+	glm::vec3 mesh_center(0.0f);
+	float mesh_area = 0.0f;
+	for (size_t t = 0; t < triangle_count; t++) {
+		const glm::vec3& a = vertices[indices[3 * t]].position;
+		const glm::vec3& b = vertices[indices[3 * t + 1]].position;
+		const glm::vec3& c = vertices[indices[3 * t + 2]].position;
+		float area = glm::length(glm::cross(b - a, c - a));
+		mesh_center += (a + b + c) * (area / 3.0f);
+		mesh_area += area;
+	}
+	if (mesh_area > 0.0f) { mesh_center = mesh_center / mesh_area; }
+
+	std::vector<Cluster> clusters(cluster_starts.size());
+	for (size_t i = 0; i < clusters.size(); i++) {
+		clusters[i].first = cluster_starts[i];
+		clusters[i].count = (i + 1 < cluster_starts.size() ? cluster_starts[i + 1] : triangle_count) - cluster_starts[i];
+
+		glm::vec3 center(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = clusters[i].first; t < clusters[i].first + clusters[i].count; t++) {
+			const glm::vec3& a = vertices[indices[3 * t]].position;
+			const glm::vec3& b = vertices[indices[3 * t + 1]].position;
+			const glm::vec3& c = vertices[indices[3 * t + 2]].position;
+			glm::vec3 n = glm::cross(b - a, c - a); // length = 2 * area
+			float triangle_area = glm::length(n);
+			center += (a + b + c) * (triangle_area / 3.0f);
+			normal += n;
+			area += triangle_area;
+		}
+		if (area > 0.0f) { center = center / area; }
+		float normal_length = glm::length(normal);
+		clusters[i].occlusion = normal_length > 0.0f ? glm::dot(center - mesh_center, normal / normal_length) : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(),
+		[](const Cluster& a, const Cluster& b) { return a.occlusion > b.occlusion; });
+
+	std::vector<GLuint> sorted;
+	sorted.reserve(indices.size());
+	for (size_t i = 0; i < clusters.size(); i++) {
+		sorted.insert(sorted.end(), indices.begin() + 3 * clusters[i].first,
+			indices.begin() + 3 * (clusters[i].first + clusters[i].count));
+	}
+	indices.swap(sorted);
+}
+
+// vertices renumbered in first-use order so vertex fetch walks memory linearly, unused ones are dropped
+static void reorderVertices(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+	std::vector<GLuint> remap(vertices.size(), GLuint(-1));
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+	for (size_t i = 0; i < indices.size(); i++) {
+		GLuint& index = indices[i];
+		if (remap[index] == GLuint(-1)) {
+			remap[index] = GLuint(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(reordered);
+}
+
+void optimizeMesh(MeshData& mesh)
+{
+	if (mesh.mapping || mesh.index_storage.size() < 3) { return; }
+
+	VertexCacheStats before = analyzeVertexCache(mesh.indices(), mesh.index_count, mesh.vertex_count);
+
+	std::vector<size_t> cluster_starts;
+	mesh.index_storage = tipsify(mesh.index_storage, mesh.vertex_count, cluster_starts);
+	sortClustersForOverdraw(mesh.index_storage, cluster_starts, mesh.vertex_storage);
+	reorderVertices(mesh.vertex_storage, mesh.index_storage);
+	mesh.vertex_count = GLsizei(mesh.vertex_storage.size());
+
+	VertexCacheStats after = analyzeVertexCache(mesh.indices(), mesh.index_count, mesh.vertex_count);
+	std::ostringstream log;
+	log << "ACMR: " << before.acmr << " -> " << after.acmr
+	    << ", ATVR: " << before.atvr << " -> " << after.atvr
+	    << " (" << cluster_starts.size() << " clusters)\n";
+	std::cout << log.str();
+}
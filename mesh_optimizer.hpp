@@ -0,0 +1,15 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== MESH OPTIMIZER ==================== */
+
+// post-transform cache efficiency of an index buffer, simulated with a FIFO cache of VERTEX_CACHE_SIZE
+struct VertexCacheStats {
+    float acmr; // cache misses per triangle, 0.5 is ideal for large regular meshes
+    float atvr; // cache misses per vertex, 1.0 is ideal
+};
+
+VertexCacheStats analyzeVertexCache(const GLuint* indices, GLsizei index_count, GLsizei vertex_count);
+
+// Tipsify triangle order (Sander et al. 2007), clusters sorted for overdraw, then vertices in first-use order
+void optimizeMesh(MeshData& mesh);
@@ -0,0 +1,128 @@
+#include "program_cache.hpp"
+#include <cstring>
+#include <sys/stat.h>
+
+static const char     PROGRAM_CACHE_MAGIC[4] = { 'A', 'H', 'P', 'C' };
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+static int cache_hits = 0, cache_misses = 0;
+
+// FNV-1a, 64 bit, continued from hash
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const char* string)
+{
+	return string ? hashBytes(hash, string, std::strlen(string) + 1) : hash;
+}
+
+static std::string cachePath(uint64_t key)
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "/%016llx.program", (unsigned long long)key);
+	return std::string(PROGRAM_CACHE_DIR) + name;
+}
+
+uint64_t programCacheKey(const std::string* sources, const GLenum* types, int count)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+	hash = hashString(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	hash = hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+	for (int i = 0; i < count; i++) {
+		hash = hashBytes(hash, &types[i], sizeof(GLenum));
+		hash = hashBytes(hash, sources[i].data(), sources[i].size());
+	}
+	return hash;
+}
+
+bool loadProgramBinary(GLuint program, uint64_t key)
+{
+	std::string cache_file = cachePath(key);
+	std::FILE* file = std::fopen(cache_file.c_str(), "rb");
+	if (!file) {
+		cache_misses++;
+		return false;
+	}
+
+	ProgramCacheHeader header;
+	std::vector<char> binary;
+	bool valid = std::fread(&header, sizeof(header), 1, file) == 1
+	          && std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, 4) == 0
+	          && header.version == PROGRAM_CACHE_VERSION
+	          && header.key == key;
+	if (valid) {
+		binary.resize(header.binary_size);
+		valid = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+	}
+	std::fclose(file);
+
+	// the driver may still refuse a binary it wrote itself, e.g. after a GPU change
+	GLint linked = GL_FALSE;
+	if (valid) {
+		glProgramBinary(program, header.binary_format, binary.data(), GLsizei(binary.size()));
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	}
+	if (!linked) {
+		cache_misses++;
+		return false;
+	}
+	cache_hits++;
+	return true;
+}
+
+void saveProgramBinary(GLuint program, uint64_t key)
+{
+	GLint formats = 0, length = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (formats == 0 || length <= 0) { return; }
+
+	ProgramCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+	header.version = PROGRAM_CACHE_VERSION;
+	header.key = key;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	header.binary_format = format;
+	header.binary_size = uint32_t(length);
+
+	mkdir(PROGRAM_CACHE_DIR, 0755);
+
+	// same write-and-rename as the mesh cache
+	std::string cache_file = cachePath(key);
+	std::string temp_file = cache_file + ".tmp";
+	std::FILE* file = std::fopen(temp_file.c_str(), "wb");
+	if (!file) {
+		std::cout << "program cache: could not write " << temp_file << std::endl;
+		return;
+	}
+	bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+	            && std::fwrite(binary.data(), 1, size_t(length), file) == size_t(length);
+	written = (std::fclose(file) == 0) && written;
+
+	if (!written || std::rename(temp_file.c_str(), cache_file.c_str()) != 0) {
+		std::remove(temp_file.c_str());
+		std::cout << "program cache: could not write " << cache_file << std::endl;
+	}
+}
+
+int programCacheHits()
+{
+	return cache_hits;
+}
+
+int programCacheMisses()
+{
+	return cache_misses;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "application.hpp"
+#include <stdint.h>
+
+/* ==================== PROGRAM CACHE ==================== */
+
+// cache/<key>.program layout: header, then the binary returned by glGetProgramBinary. The key hashes
+// every stage source after define injection together with the GL vendor, renderer and version
+// strings, so an edited shader or a driver update simply misses and the program is compiled again.
+struct ProgramCacheHeader {
+    char     magic[4];      // "AHPC"
+    uint32_t version;
+    uint64_t key;
+    uint32_t binary_format;
+    uint32_t binary_size;
+};
+
+// needs a GL context for the driver strings
+uint64_t programCacheKey(const std::string* sources, const GLenum* types, int count);
+
+// true when program was linked from the cached binary, false on a miss or a rejected binary
+bool loadProgramBinary(GLuint program, uint64_t key);
+
+// program has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+void saveProgramBinary(GLuint program, uint64_t key);
+
+// programs loaded and compiled since start
+int programCacheHits();
+int programCacheMisses();
@@ -0,0 +1,209 @@
+#include "render_queue.hpp"
+#include "frame_stats.hpp"
+#include <algorithm>
+
+static std::vector<RenderItem> render_queue;
+
+// program -> variant per RenderMode
+struct ProgramVariants {
+    GLuint programs[5];
+};
+static std::vector<ProgramVariants> program_variants;
+static uint64_t sequence = 0;
+
+// bound state, 0xFFFFFFFF = unknown
+static GLuint current_program, current_vao, current_texture, current_instance_buffer, current_indirect_buffer;
+static GLintptr current_model_offset, current_instance_offset;
+
+// pass | program | texture | vao | submission order, GL names are small so 12-16 bits are enough to group them
+static uint64_t sortKey(RenderPass pass, GLuint program, GLuint texture, GLuint vao)
+{
+	uint64_t key = uint64_t(pass) << 60;
+	if (pass == PASS_BLENDED) {
+		// back-to-front order is the caller's business
+		return key | (sequence & 0xFFFFFFFFFFFFULL);
+	}
+	return key | (uint64_t(program & 0xFFF) << 48) | (uint64_t(texture & 0xFFFF) << 32)
+	           | (uint64_t(vao & 0xFFFF) << 16) | (sequence & 0xFFFF);
+}
+
+static bool compareKeys(const RenderItem& a, const RenderItem& b)
+{
+	return a.key < b.key;
+}
+
+void beginRenderQueue()
+{
+	render_queue.clear();
+	sequence = 0;
+	invalidateRenderState();
+}
+
+void submitModel(RenderPass pass, const Mesh& mesh, GLuint program, GLuint texture, const UniformAllocation& model)
+{
+	RenderItem item;
+	item.key = sortKey(pass, program, texture, mesh.vao);
+	item.pass = pass;
+	item.program = program;
+	item.texture = texture;
+	item.mesh = &mesh;
+	item.indirect = NULL;
+	item.model = model;
+	item.instance_buffer = 0;
+	item.instances.offset = 0;
+	item.instances.size = 0;
+	item.instance_count = 1;
+	render_queue.push_back(item);
+	sequence++;
+}
+
+void submitInstanced(RenderPass pass, const Mesh& mesh, GLuint program, GLuint texture, GLuint instance_buffer, GLsizei instance_count)
+{
+	RenderItem item;
+	item.key = sortKey(pass, program, texture, mesh.vao);
+	item.pass = pass;
+	item.program = program;
+	item.texture = texture;
+	item.mesh = &mesh;
+	item.indirect = NULL;
+	item.model.offset = 0;
+	item.model.size = 0;
+	item.instance_buffer = instance_buffer;
+	item.instances.offset = 0;
+	item.instances.size = 0;
+	item.instance_count = instance_count;
+	render_queue.push_back(item);
+	sequence++;
+}
+
+void submitInstancedStorage(RenderPass pass, const Mesh& mesh, GLuint program, GLuint texture, const UniformAllocation& instances, GLsizei instance_count)
+{
+	RenderItem item;
+	item.key = sortKey(pass, program, texture, mesh.vao);
+	item.pass = pass;
+	item.program = program;
+	item.texture = texture;
+	item.mesh = &mesh;
+	item.indirect = NULL;
+	item.model.offset = 0;
+	item.model.size = 0;
+	item.instance_buffer = 0;
+	item.instances = instances;
+	item.instance_count = instance_count;
+	render_queue.push_back(item);
+	sequence++;
+}
+
+void submitIndirect(RenderPass pass, const IndirectDraw& draw, GLuint program, const UniformAllocation& model)
+{
+	RenderItem item;
+	item.key = sortKey(pass, program, draw.texture, draw.vao);
+	item.pass = pass;
+	item.program = program;
+	item.texture = draw.texture;
+	item.mesh = NULL;
+	item.indirect = &draw;
+	item.model = model;
+	item.instance_buffer = draw.draw_buffer;
+	item.instances.offset = 0;
+	item.instances.size = 0;
+	item.instance_count = 1;
+	render_queue.push_back(item);
+	sequence++;
+}
+
+void sortRenderQueue()
+{
+	std::sort(render_queue.begin(), render_queue.end(), compareKeys);
+}
+
+void invalidateRenderState()
+{
+	current_program = current_vao = current_texture = current_instance_buffer = current_indirect_buffer = 0xFFFFFFFF;
+	current_model_offset = current_instance_offset = -1;
+}
+
+void setProgramVariants(GLuint program, GLuint depth_program, GLuint overdraw_program, GLuint gbuffer_program, GLuint clustered_program)
+{
+	ProgramVariants variants = { { program, depth_program, overdraw_program, gbuffer_program, clustered_program } };
+	program_variants.push_back(variants);
+}
+
+static GLuint programVariant(GLuint program, RenderMode mode)
+{
+	if (mode == RENDER_SHADED) { return program; }
+	for (size_t i = 0; i < program_variants.size(); i++) {
+		if (program_variants[i].programs[RENDER_SHADED] == program) { return program_variants[i].programs[mode]; }
+	}
+	throw "ERROR::RENDERQUEUE::No program variant registered.";
+}
+
+// true when the bind has to be issued
+static bool changeState(GLuint& current, GLuint wanted)
+{
+	if (current == wanted) {
+		frame_stats.state_changes_saved++;
+		return false;
+	}
+	current = wanted;
+	frame_stats.state_changes++;
+	return true;
+}
+
+void executeRenderPass(RenderPass pass, RenderMode mode)
+{
+	bool textured = mode == RENDER_SHADED || mode == RENDER_GBUFFER || mode == RENDER_CLUSTERED;
+	for (size_t i = 0; i < render_queue.size(); i++) {
+		const RenderItem& item = render_queue[i];
+		if (item.pass != pass) { continue; }
+
+		GLuint vao = item.mesh ? item.mesh->vao : item.indirect->vao;
+		GLuint program = programVariant(item.program, mode);
+		if (changeState(current_program, program)) { glUseProgram(program); }
+		if (changeState(current_vao, vao)) { glBindVertexArray(vao); }
+		if (textured && item.texture && changeState(current_texture, item.texture)) { glBindTextureUnit(0, item.texture); }
+
+		if (item.instance_buffer && changeState(current_instance_buffer, item.instance_buffer)) {
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, item.instance_buffer);
+			current_instance_offset = -1;
+		}
+		else if (item.instances.size) {
+			// storage ring range
+			if (current_instance_buffer == item.instances.buffer && current_instance_offset == item.instances.offset) {
+				frame_stats.state_changes_saved++;
+			}
+			else {
+				current_instance_buffer = item.instances.buffer;
+				current_instance_offset = item.instances.offset;
+				frame_stats.state_changes++;
+				bindStorage(3, item.instances);
+			}
+		}
+		if (item.model.size) {
+			if (current_model_offset == item.model.offset) {
+				frame_stats.state_changes_saved++;
+			}
+			else {
+				current_model_offset = item.model.offset;
+				frame_stats.state_changes++;
+				bindUniforms(2, item.model);
+			}
+		}
+
+		if (item.indirect) {
+			const IndirectDraw& draw = *item.indirect;
+			if (changeState(current_indirect_buffer, draw.command_buffer)) {
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw.command_buffer);
+			}
+			drawIndirect(draw);
+			frame_stats.indirect_commands += draw.command_count;
+		}
+		else if (item.instance_buffer || item.instances.size) {
+			drawMeshInstanced(*item.mesh, item.instance_count);
+		}
+		else {
+			drawMesh(*item.mesh);
+		}
+		frame_stats.draw_calls++;
+	}
+}
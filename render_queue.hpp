@@ -0,0 +1,61 @@
+#pragma once
+#include "application.hpp"
+#include "uniform_ring.hpp"
+#include "static_scene.hpp"
+#include <stdint.h>
+
+/* ==================== RENDER QUEUE ==================== */
+
+// Draws are collected per frame, sorted once by (pass, program, texture, VAO) and executed with
+// redundant program/VAO/texture/buffer binds skipped. The blended pass keeps submission order.
+
+enum RenderPass {
+    PASS_OPAQUE = 0,
+    PASS_BLENDED = 1
+};
+
+// how executeRenderPass draws the items
+enum RenderMode {
+    RENDER_SHADED = 0,     // the item's own program
+    RENDER_DEPTH_ONLY = 1, // depth variant, no textures, for the depth pre-pass
+    RENDER_OVERDRAW = 2,   // overdraw variant, no textures, additive blending set by the caller
+    RENDER_GBUFFER = 3,    // G-buffer variant, textured, writes the deferred shading inputs
+    RENDER_CLUSTERED = 4   // clustered lighting variant, textured, light lists bound by buildClusters()
+};
+
+struct RenderItem {
+    uint64_t key;
+    RenderPass pass;
+    GLuint program;
+    GLuint texture;          // 0 = shader does not sample
+    const Mesh* mesh;             // null for indirect items
+    const IndirectDraw* indirect; // command range drawn with one multi-draw call
+    UniformAllocation model;      // ModelUBO at binding 2, size 0 when the shader does not read it
+    GLuint instance_buffer;       // SSBO at binding 3, 0 for single draws
+    UniformAllocation instances;  // per-frame SSBO range at binding 3 when instance_buffer is 0, size 0 = none
+    GLsizei instance_count;
+};
+
+void beginRenderQueue();
+
+void submitModel(RenderPass pass, const Mesh& mesh, GLuint program, GLuint texture, const UniformAllocation& model);
+
+void submitInstanced(RenderPass pass, const Mesh& mesh, GLuint program, GLuint texture, GLuint instance_buffer, GLsizei instance_count);
+
+// instance data written into the uniform ring this frame, e.g. after culling
+void submitInstancedStorage(RenderPass pass, const Mesh& mesh, GLuint program, GLuint texture, const UniformAllocation& instances, GLsizei instance_count);
+
+// draw has to stay alive until the pass is executed, its textures are bound when the item is drawn
+void submitIndirect(RenderPass pass, const IndirectDraw& draw, GLuint program, const UniformAllocation& model);
+
+// sorts the queue, call once after all submissions
+void sortRenderQueue();
+
+// registers the depth-only, overdraw, G-buffer and clustered programs built from the same vertex shader as program
+void setProgramVariants(GLuint program, GLuint depth_program, GLuint overdraw_program, GLuint gbuffer_program, GLuint clustered_program);
+
+// executes the items of one pass, state is tracked across passes of the same frame
+void executeRenderPass(RenderPass pass, RenderMode mode);
+
+// forget the tracked state after GL state was changed outside the queue
+void invalidateRenderState();
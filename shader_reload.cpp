@@ -0,0 +1,235 @@
+#include "shader_reload.hpp"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+static const char* const SHADER_DIR = "shaders";
+
+struct WatchedProgram {
+	GLuint program;
+	std::string names[2];
+	GLenum types[2];
+	int shader_count;
+	std::string defines;
+};
+
+// scratch program compiling on the driver threads
+struct ReloadingProgram {
+	size_t watched; // index into watched_programs
+	GLuint program;
+	GLuint shaders[2];
+};
+
+static std::vector<WatchedProgram> watched_programs;
+static std::vector<ReloadingProgram> reloading_programs;
+
+static std::thread watcher;
+static std::atomic<bool> watcher_stopping(false);
+static int inotify_fd = -1;
+
+// written by the watcher, taken by reloadShaders()
+static std::mutex changed_mutex;
+static std::set<std::string> changed_files;
+
+void registerProgram(GLuint program, const char* const* names, const GLenum* types, int count, const char* defines)
+{
+	WatchedProgram watched;
+	watched.program = program;
+	watched.shader_count = count;
+	watched.defines = defines;
+	for (int i = 0; i < count; i++) {
+		watched.names[i] = names[i];
+		watched.types[i] = types[i];
+	}
+	watched_programs.push_back(watched);
+}
+
+static void watchShaders()
+{
+	// editors either rewrite the file or rename a temporary over it
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	while (!watcher_stopping) {
+		pollfd poll_fd = { inotify_fd, POLLIN, 0 };
+		if (poll(&poll_fd, 1, 100) <= 0) { continue; }
+
+		ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length; ) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			if (event->len) {
+				std::lock_guard<std::mutex> lock(changed_mutex);
+				changed_files.insert(std::string(SHADER_DIR) + "/" + event->name);
+			}
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+}
+
+void startShaderWatcher()
+{
+	inotify_fd = inotify_init1(IN_CLOEXEC);
+	if (inotify_fd < 0 || inotify_add_watch(inotify_fd, SHADER_DIR, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		std::cout << "shader reload: could not watch " << SHADER_DIR << std::endl;
+		if (inotify_fd >= 0) { close(inotify_fd); }
+		inotify_fd = -1;
+		return;
+	}
+	watcher_stopping = false;
+	watcher = std::thread(watchShaders);
+}
+
+void stopShaderWatcher()
+{
+	if (!watcher.joinable()) { return; }
+	watcher_stopping = true;
+	watcher.join();
+	close(inotify_fd);
+	inotify_fd = -1;
+}
+
+static bool uses(const WatchedProgram& watched, const std::set<std::string>& files)
+{
+	for (int i = 0; i < watched.shader_count; i++) {
+		if (files.count(watched.names[i])) { return true; }
+		if (files.count(LIGHTING_SHADER) && usesLightingShader(watched.names[i].c_str(), watched.defines.c_str())) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool reloading(size_t watched)
+{
+	for (size_t i = 0; i < reloading_programs.size(); i++) {
+		if (reloading_programs[i].watched == watched) { return true; }
+	}
+	return false;
+}
+
+static void startReload(size_t index)
+{
+	const WatchedProgram& watched = watched_programs[index];
+	std::string sources[2];
+	try {
+		for (int i = 0; i < watched.shader_count; i++) {
+			sources[i] = shaderSource(watched.names[i].c_str(), watched.defines.c_str());
+		}
+	}
+	catch (...) {
+		return; // removed or being replaced, the next event retries
+	}
+
+	ReloadingProgram reload;
+	reload.watched = index;
+	reload.program = glCreateProgram();
+	for (int i = 0; i < watched.shader_count; i++) {
+		const char* shader_string = sources[i].c_str();
+		reload.shaders[i] = glCreateShader(watched.types[i]);
+		glShaderSource(reload.shaders[i], 1, &shader_string, NULL);
+		glCompileShader(reload.shaders[i]);
+		glAttachShader(reload.program, reload.shaders[i]);
+	}
+	glProgramParameteri(reload.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(reload.program);
+	reloading_programs.push_back(reload);
+}
+
+// the new executable goes into the original program object, through its binary when the driver
+// has a binary format, otherwise by linking the original again with the new shaders
+static bool swapProgram(const ReloadingProgram& reload, const WatchedProgram& watched)
+{
+	GLint formats = 0, length = 0, linked = GL_FALSE;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	glGetProgramiv(reload.program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (formats > 0 && length > 0) {
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinary(reload.program, length, &length, &format, binary.data());
+		glProgramBinary(watched.program, format, binary.data(), length);
+		glGetProgramiv(watched.program, GL_LINK_STATUS, &linked);
+	}
+	if (!linked) {
+		GLuint attached[4];
+		GLsizei attached_count = 0;
+		glGetAttachedShaders(watched.program, 4, &attached_count, attached);
+		for (GLsizei i = 0; i < attached_count; i++) { glDetachShader(watched.program, attached[i]); }
+		for (int i = 0; i < watched.shader_count; i++) { glAttachShader(watched.program, reload.shaders[i]); }
+		glLinkProgram(watched.program);
+		for (int i = 0; i < watched.shader_count; i++) { glDetachShader(watched.program, reload.shaders[i]); }
+		linked = checkStatus(watched.program, GL_LINK_STATUS, watched.names[watched.shader_count - 1].c_str());
+	}
+	return linked == GL_TRUE;
+}
+
+// true when the scratch program was checked, swapped in or dropped
+static bool finishReload(const ReloadingProgram& reload, bool& swapped)
+{
+	if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile) {
+		GLint done = GL_FALSE;
+		glGetProgramiv(reload.program, GL_COMPLETION_STATUS_KHR, &done);
+		if (!done) { return false; }
+	}
+
+	const WatchedProgram& watched = watched_programs[reload.watched];
+	bool compiled = true;
+	for (int i = 0; i < watched.shader_count; i++) {
+		compiled = checkStatus(reload.shaders[i], GL_COMPILE_STATUS, watched.names[i].c_str()) && compiled;
+	}
+	const char* name = watched.names[watched.shader_count - 1].c_str();
+	if (compiled && checkStatus(reload.program, GL_LINK_STATUS, name) && swapProgram(reload, watched)) {
+		std::cout << "shader reload: " << watched.names[0] << (watched.shader_count > 1 ? " + " + watched.names[1] : std::string())
+		          << (watched.defines.empty() ? "" : " (variant)") << " reloaded" << std::endl;
+		swapped = true;
+	}
+	else {
+		std::cout << "shader reload: keeping the previous " << name << std::endl;
+	}
+
+	for (int i = 0; i < watched.shader_count; i++) {
+		glDetachShader(reload.program, reload.shaders[i]);
+		glDeleteShader(reload.shaders[i]);
+	}
+	glDeleteProgram(reload.program);
+	return true;
+}
+
+bool reloadShaders()
+{
+	std::set<std::string> files;
+	{
+		std::lock_guard<std::mutex> lock(changed_mutex);
+		files.swap(changed_files);
+	}
+
+	// files of a program still compiling from an earlier save are queued again for the next frame
+	std::set<std::string> retry;
+	for (size_t i = 0; i < watched_programs.size() && !files.empty(); i++) {
+		const WatchedProgram& watched = watched_programs[i];
+		if (!uses(watched, files)) { continue; }
+		if (!reloading(i)) {
+			startReload(i);
+			continue;
+		}
+		for (int j = 0; j < watched.shader_count; j++) {
+			if (files.count(watched.names[j])) { retry.insert(watched.names[j]); }
+			if (files.count(LIGHTING_SHADER) && usesLightingShader(watched.names[j].c_str(), watched.defines.c_str())) {
+				retry.insert(LIGHTING_SHADER);
+			}
+		}
+	}
+	if (!retry.empty()) {
+		std::lock_guard<std::mutex> lock(changed_mutex);
+		changed_files.insert(retry.begin(), retry.end());
+	}
+
+	bool swapped = false;
+	for (size_t i = 0; i < reloading_programs.size(); i++) {
+		if (finishReload(reloading_programs[i], swapped)) {
+			reloading_programs.erase(reloading_programs.begin() + i--);
+		}
+	}
+	return swapped;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== SHADER HOT RELOAD ==================== */
+
+// A watcher thread reads inotify events of shaders/ and queues the names of written files. Once per
+// frame the render thread starts a compile of every program using one of them into a scratch
+// program, without waiting. When the driver is done, a program that compiled and linked replaces
+// the executable of the original program object, so all stored program names stay valid. A failed
+// compile prints the info log and keeps the old program.
+
+// remembers the sources of a program for reloading, called by createProgram and createComputeProgram
+void registerProgram(GLuint program, const char* const* names, const GLenum* types, int count, const char* defines);
+
+// starts the watcher thread, returns without it when inotify is not available
+void startShaderWatcher();
+
+void stopShaderWatcher();
+
+// called once per frame on the GL thread, true when a program was replaced, its uniforms are reset
+bool reloadShaders();
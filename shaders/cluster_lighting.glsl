@@ -0,0 +1,64 @@
+// shared light math, shaderSource() prepends it after the defines of the fragment shaders built
+// with LIGHTING_DEFINE
+
+/* CONSTANTS */
+const float LIGHT_POINT = 0.0;
+// attenuation coeficients, as for the main light in texture.frag
+const float LIGHT_CONSTANT = 0.5;
+const float LIGHT_LINEAR = -0.1;
+const float LIGHT_QUADRATIC = 0.04;
+
+/* BUFFERS */
+struct Light {
+	vec4 position; // w = radius
+	vec4 color;    // a = intensity
+	vec4 direction;
+	vec4 params;   // x = type, y/z = spot inner/outer angle
+};
+
+layout(binding = 4, std430) readonly buffer LightBuffer {
+	Light lights[];
+};
+
+// point lights as the main light, spotlights as the train spotlight
+float lightIntensity(Light light, vec3 position, vec3 N, vec3 V, float shininess)
+{
+    vec3 L = normalize(light.position.xyz - position);     // frag to light direction
+    if (light.params.x == LIGHT_POINT) {
+        float D = distance(light.position.xyz, position);   // light distance
+        vec3 R = reflect(-L, N);                            // reflection direction
+        float ambient = 0.1;
+        float diffuse = max(dot(N, L), 0.0);
+        float specular = pow(max(dot(V, R), 0.0), 8);
+        float attenuation = 1.0 / (LIGHT_CONSTANT + LIGHT_LINEAR * D + LIGHT_QUADRATIC * pow(D, 2));
+        return (ambient + diffuse + specular * shininess) * attenuation;
+    }
+    float spot_angle = dot(light.direction.xyz, -L);
+    float spot_diffuse = max(dot(N, L), 0.0);
+    return spot_diffuse * clamp((spot_angle - light.params.z) / (light.params.z - light.params.y), 0.0, 1.0);
+}
+
+#ifdef CLUSTERED_LIGHTING
+// per cluster: light count, then the light indices
+layout(binding = 5, std430) readonly buffer ClusterBuffer {
+	uint clusters[];
+};
+
+// lights of the cluster containing the fragment
+vec3 clusterLighting(vec3 position, float view_depth, vec3 N, vec3 V, float shininess)
+{
+    float slice = log(view_depth / CLUSTER_NEAR) / log(CLUSTER_FAR / CLUSTER_NEAR) * CLUSTER_Z;
+    uvec2 tile = uvec2(gl_FragCoord.xy / SCREEN_SIZE * vec2(CLUSTER_X, CLUSTER_Y));
+    uint cluster = tile.x + CLUSTER_X * (tile.y + CLUSTER_Y * uint(clamp(slice, 0.0, float(CLUSTER_Z - 1))));
+    uint offset = cluster * (MAX_CLUSTER_LIGHTS + 1u);
+
+    vec3 light_sum = vec3(0.0);
+    uint count = clusters[offset];
+    for (uint i = 0u; i < count; i++) {
+        Light light = lights[clusters[offset + 1u + i]];
+        if (distance(light.position.xyz, position) > light.position.w) { continue; }
+        light_sum += light.color.rgb * light.color.a * lightIntensity(light, position, N, V, shininess);
+    }
+    return light_sum;
+}
+#endif
@@ -21,12 +21,17 @@ layout(binding = 2, std140) uniform ModelMatrixUBO {
 layout(location = 0) out vec3 fs_position;
 layout(location = 1) out vec3 fs_normal;
 layout(location = 2) out vec2 fs_uv;
+layout(location = 3) out float fs_shininess;
+
+// same depth in the pre-pass and the shading pass, which use different programs
+invariant gl_Position;
 
 void main()
 {
 	fs_position = (model.matrix * vec4(position, 1.0f)).xyz;
 	fs_uv = uv;
 	fs_normal = normal;
+	fs_shininess = model.shinines;
 
     gl_Position = camera.projection * camera.view * model.matrix * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+#version 450
+
+/* IN */
+layout(location = 0) flat in int fs_light;
+
+/* OUT */
+layout(location = 0) out vec4 final_color; // added to the lighting target
+
+/* BUFFERS */
+layout(binding = 0) uniform sampler2D albedo_buffer;
+layout(binding = 1) uniform sampler2D normal_buffer; // w = shininess, < 0 for unlit surfaces
+layout(binding = 2) uniform sampler2D position_buffer;
+
+layout(binding = 1, std140) uniform Camera {
+	mat4 projection;
+	mat4 view;
+	vec3 position;
+} camera;
+
+void main()
+{
+    /* G-BUFFER */
+
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 normal_shininess = texelFetch(normal_buffer, texel, 0);
+    if (normal_shininess.w < 0.0) discard;
+
+    vec3 fs_position = texelFetch(position_buffer, texel, 0).xyz;
+    Light light = lights[fs_light];
+    float D = distance(light.position.xyz, fs_position);    // light distance
+    if (D > light.position.w) discard;                       // outside the volume, the sphere is only a bound
+
+    vec4 texture_color = texelFetch(albedo_buffer, texel, 0);
+
+    /* LIGHTING */
+
+    vec3 N = normal_shininess.xyz;                           // normal
+    vec3 V = normalize(camera.position - fs_position);       // view direction
+    float intensity = lightIntensity(light, fs_position, N, V, normal_shininess.w);
+
+    /* FINAL COLOR */
+
+    final_color = vec4(texture_color.rgb * light.color.rgb * light.color.a * intensity, 0.0);
+}
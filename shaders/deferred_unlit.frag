@@ -0,0 +1,16 @@
+#version 450
+
+// out
+layout(location = 0) out vec4 final_color;
+
+// G-buffer
+layout(binding = 0) uniform sampler2D albedo_buffer;
+layout(binding = 1) uniform sampler2D normal_buffer;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    if (texelFetch(normal_buffer, texel, 0).w >= 0.0) discard;
+
+    final_color = vec4(texelFetch(albedo_buffer, texel, 0).rgb, 0.0);
+}
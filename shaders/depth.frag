@@ -0,0 +1,6 @@
+#version 450
+
+// occluder pass, depth only
+void main()
+{
+}
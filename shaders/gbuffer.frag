@@ -0,0 +1,22 @@
+#version 450
+
+/* IN */
+layout(location = 0) in vec3 fs_position;
+layout(location = 1) in vec3 fs_normal;
+layout(location = 2) in vec2 fs_uv;
+layout(location = 3) in float fs_shininess; // per model or per instance
+
+/* OUT */
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 normal_shininess;
+layout(location = 2) out vec4 position;
+
+/* BUFFERS */
+layout(binding = 0) uniform sampler2D texture_sampler;
+
+void main()
+{
+    albedo = texture(texture_sampler, fs_uv);
+    normal_shininess = vec4(normalize(fs_normal), fs_shininess);
+    position = vec4(fs_position, 1.0);
+}
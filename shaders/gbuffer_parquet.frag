@@ -0,0 +1,32 @@
+#version 450
+
+// in
+layout(location = 0) in vec3 fs_position;
+layout(location = 1) in vec3 fs_normal;
+layout(location = 2) in vec2 fs_uv;
+
+// out
+layout(location = 0) out vec4 albedo;
+layout(location = 1) out vec4 normal_shininess;
+layout(location = 2) out vec4 position;
+
+// variables, same pattern as procedural_parquet.frag
+vec4 BROWN = vec4(0.6, 0.3, 0.0, 1.0);
+vec4 LIGHT_BROWN = vec4(1.0, 0.6, 0.2, 1.0);
+
+float TILE_WIDTH = 1.0 / 20;
+float TILE_HEIGHT = 1.0 / 10;
+float GAP = TILE_WIDTH * 0.01;
+float Y_OFFSET = TILE_HEIGHT / 3;
+
+
+void main()
+{
+    float is_in_x_gap = 1 - step(GAP, mod(fs_uv.x, TILE_WIDTH));
+    float is_in_y_gap = 1 - step(GAP, mod(fs_uv.y + (Y_OFFSET * floor(fs_uv.x / TILE_WIDTH)), TILE_HEIGHT));
+    float is_in_gap = clamp(is_in_x_gap + is_in_y_gap, 0.0, 1.0);
+
+    albedo = LIGHT_BROWN * is_in_gap + BROWN * (1 - is_in_gap);
+    normal_shininess = vec4(normalize(fs_normal), 0.7);
+    position = vec4(fs_position, 1.0);
+}
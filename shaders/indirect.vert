@@ -0,0 +1,45 @@
+#version 450
+#extension GL_ARB_shader_draw_parameters : require
+
+// in
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 uv;
+
+
+layout(binding = 1, std140) uniform Camera {
+	mat4 projection;
+	mat4 view;
+	vec3 position;
+} camera;
+
+struct Draw {
+	mat4 matrix;
+	vec4 sphere; // culling bounds
+	float shinines;
+};
+
+// one record per indirect command, base instance = command index
+layout(binding = 3, std430) readonly buffer DrawBuffer {
+	Draw draws[];
+};
+
+// out
+layout(location = 0) out vec3 fs_position;
+layout(location = 1) out vec3 fs_normal;
+layout(location = 2) out vec2 fs_uv;
+layout(location = 3) out float fs_shininess;
+
+invariant gl_Position;
+
+void main()
+{
+	Draw draw = draws[gl_BaseInstanceARB];
+
+	fs_position = (draw.matrix * vec4(position, 1.0f)).xyz;
+	fs_uv = uv;
+	fs_normal = normal;
+	fs_shininess = draw.shinines;
+
+    gl_Position = camera.projection * camera.view * draw.matrix * vec4(position, 1.0);
+}
@@ -0,0 +1,42 @@
+#version 450
+
+// in
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 uv;
+
+
+layout(binding = 1, std140) uniform Camera {
+	mat4 projection;
+	mat4 view;
+	vec3 position;
+} camera;
+
+struct Instance {
+	mat4 matrix;
+	float shinines;
+};
+
+layout(binding = 3, std430) readonly buffer InstanceBuffer {
+	Instance instances[];
+};
+
+// out
+layout(location = 0) out vec3 fs_position;
+layout(location = 1) out vec3 fs_normal;
+layout(location = 2) out vec2 fs_uv;
+layout(location = 3) out float fs_shininess;
+
+invariant gl_Position;
+
+void main()
+{
+	Instance instance = instances[gl_InstanceID];
+
+	fs_position = (instance.matrix * vec4(position, 1.0f)).xyz;
+	fs_uv = uv;
+	fs_normal = normal;
+	fs_shininess = instance.shinines;
+
+    gl_Position = camera.projection * camera.view * instance.matrix * vec4(position, 1.0);
+}
@@ -0,0 +1,33 @@
+#version 450
+
+// in
+layout(location = 0) in vec3 position; // unit sphere
+
+
+layout(binding = 1, std140) uniform Camera {
+	mat4 projection;
+	mat4 view;
+	vec3 position;
+} camera;
+
+struct Light {
+	vec4 position; // w = radius
+	vec4 color;    // a = intensity
+	vec4 direction;
+	vec4 params;   // x = type, y/z = spot inner/outer angle
+};
+
+layout(binding = 4, std430) readonly buffer LightBuffer {
+	Light lights[];
+};
+
+// out
+layout(location = 0) flat out int fs_light;
+
+void main()
+{
+	Light light = lights[gl_InstanceID];
+	fs_light = gl_InstanceID;
+
+    gl_Position = camera.projection * camera.view * vec4(light.position.xyz + position * light.position.w, 1.0);
+}
@@ -0,0 +1,12 @@
+#version 450
+
+// overdraw view, every shaded fragment adds one step with additive blending, 8 layers = white
+const float OVERDRAW_STEP = 0.125;
+
+/* OUT */
+layout(location = 0) out vec4 final_color;
+
+void main()
+{
+    final_color = vec4(OVERDRAW_STEP, OVERDRAW_STEP, OVERDRAW_STEP, 1.0);
+}
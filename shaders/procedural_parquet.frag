@@ -34,7 +34,6 @@ float TILE_HEIGHT = 1.0 / 10;
 float GAP = TILE_WIDTH * 0.01;
 float Y_OFFSET = TILE_HEIGHT / 3;
 
-
 void main()
 {
     float is_in_x_gap = 1 - step(GAP, mod(fs_uv.x, TILE_WIDTH));
@@ -60,6 +59,11 @@ void main()
 
     /* FINAL COLOR */
 
+#ifdef CLUSTERED_LIGHTING
+    float view_depth = -(camera.view * vec4(fs_position, 1.0)).z;
+    vec3 color = texture_color.rgb * clusterLighting(fs_position, view_depth, N, V, 0.7);
+#else
     vec3 color = texture_color.rgb * (main_light);
+#endif
     final_color = vec4(color, texture_color.a); // original alpha, not affected by lighting
 }
\ No newline at end of file
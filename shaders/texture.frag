@@ -13,6 +13,7 @@ const float QUADRATIC = 0.04;
 layout(location = 0) in vec3 fs_position;
 layout(location = 1) in vec3 fs_normal;
 layout(location = 2) in vec2 fs_uv;
+layout(location = 3) in float fs_shininess; // per model or per instance
 
 /* OUT */
 layout(location = 0) out vec4 final_color;
@@ -31,11 +32,6 @@ layout(binding = 1, std140) uniform Camera {
 	vec3 position;
 } camera;
 
-layout(binding = 2, std140) uniform ModelUBO {
-	mat4 matrix;
-	float shinines;
-} model;
-
 void main()
 {
     /* TEXTURE SAMPLING */
@@ -56,7 +52,7 @@ void main()
     float diffuse = max(dot(N, Lm), 0.0);
     float specular = pow(max(dot(V, R), 0.0), 8);
     float attenuation = 1.0 / (CONSTANT + LINEAR * D + QUADRATIC * pow(D, 2));
-    float main_light = (ambient + diffuse + specular * model.shinines) * attenuation;
+    float main_light = (ambient + diffuse + specular * fs_shininess) * attenuation;
     
     // spotlight
     float spot_angle = dot(spotlight_direction, -Ls); 
@@ -66,6 +62,11 @@ void main()
 
     /* FINAL COLOR */
 
+#ifdef CLUSTERED_LIGHTING
+    float view_depth = -(camera.view * vec4(fs_position, 1.0)).z;
+    vec3 color = texture_color.rgb * clusterLighting(fs_position, view_depth, N, V, fs_shininess);
+#else
     vec3 color = texture_color.rgb * (main_light + spot_light); // lights sum
+#endif
     final_color = vec4(color, texture_color.a); // original alpha, not affected by lighting
 }
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "static_scene.hpp"
+#include "culling.hpp"
+#include "frame_stats.hpp"
+
+static std::vector<Vertex> scene_vertices;
+static std::vector<GLuint> scene_indices;
+static std::vector<DrawElementsIndirectCommand> scene_commands;
+static std::vector<DrawData> scene_draws;
+
+static GLuint scene_vbo, scene_ebo, scene_vao, command_buffer, draw_buffer;
+
+// culling pass output and its counters, one mapped counter pair per frame in flight
+static GLuint cull_program, culled_command_buffer;
+static GLuint counter_buffers[UNIFORM_RING_FRAMES];
+static GLuint* counters[UNIFORM_RING_FRAMES];
+static GLsync counter_fences[UNIFORM_RING_FRAMES];
+static int counter_slot = 0;
+
+GLsizei addStaticMesh(const MeshData& data, const ModelUBO& model)
+{
+	DrawElementsIndirectCommand command;
+	command.count = data.index_count ? data.index_count : data.vertex_count;
+	command.instance_count = 1;
+	command.first_index = GLuint(scene_indices.size());
+	command.base_vertex = GLint(scene_vertices.size());
+	command.base_instance = GLuint(scene_commands.size()); // DrawData index
+
+	scene_vertices.insert(scene_vertices.end(), data.vertices(), data.vertices() + data.vertex_count);
+	if (data.index_count) {
+		scene_indices.insert(scene_indices.end(), data.indices(), data.indices() + data.index_count);
+	}
+	else {
+		for (GLsizei i = 0; i < data.vertex_count; i++) { scene_indices.push_back(GLuint(i)); }
+	}
+
+	DrawData draw = DrawData();
+	draw.model_matrix = model.model_matrix;
+	draw.bounding_sphere = boundingSphere(data.bounds_min, data.bounds_max, model.model_matrix);
+	draw.shininess = model.shininess;
+
+	scene_commands.push_back(command);
+	scene_draws.push_back(draw);
+	return GLsizei(scene_commands.size() - 1);
+}
+
+void buildStaticScene()
+{
+	if (scene_commands.empty()) {
+		throw "ERROR::STATIC_SCENE::No meshes added.";
+	}
+
+	scene_vbo = createObjectVBO(scene_vertices.data(), GLsizei(scene_vertices.size()));
+	scene_ebo = createObjectEBO(scene_indices.data(), GLsizei(scene_indices.size()));
+	scene_vao = createObjectVAO(scene_vbo, scene_ebo);
+
+	glCreateBuffers(1, &command_buffer);
+	glNamedBufferStorage(command_buffer, scene_commands.size() * sizeof(DrawElementsIndirectCommand), scene_commands.data(), 0);
+	glCreateBuffers(1, &draw_buffer);
+	glNamedBufferStorage(draw_buffer, scene_draws.size() * sizeof(DrawData), scene_draws.data(), 0);
+
+	if (GPU_FRUSTUM_CULLING) {
+		cull_program = createComputeProgram("shaders/frustum_cull.comp");
+
+		// starts as a full copy, valid before the first pass ran
+		glCreateBuffers(1, &culled_command_buffer);
+		glNamedBufferStorage(culled_command_buffer, scene_commands.size() * sizeof(DrawElementsIndirectCommand), scene_commands.data(), 0);
+
+		GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glCreateBuffers(UNIFORM_RING_FRAMES, counter_buffers);
+		for (int i = 0; i < UNIFORM_RING_FRAMES; i++) {
+			glNamedBufferStorage(counter_buffers[i], 3 * sizeof(GLuint), NULL, flags);
+			counters[i] = static_cast<GLuint*>(glMapNamedBufferRange(counter_buffers[i], 0, 3 * sizeof(GLuint), flags));
+			if (!counters[i]) {
+				throw "ERROR::STATIC_SCENE::Could not map culling counters.";
+			}
+			counter_fences[i] = 0;
+		}
+	}
+
+	std::printf("static scene: %zu meshes, %zu vertices, %zu indices\n", scene_commands.size(),
+		scene_vertices.size(), scene_indices.size());
+
+	std::vector<Vertex>().swap(scene_vertices);
+	std::vector<GLuint>().swap(scene_indices);
+}
+
+void cullStaticScene(const glm::mat4& view_projection, GLuint hiz_texture)
+{
+	if (!GPU_FRUSTUM_CULLING) { return; }
+
+	// counts of the frame that last used this slot, UNIFORM_RING_FRAMES frames ago, beginUniformFrame()
+	// already waited for that frame so this does not block in practice
+	GLuint* slot = counters[counter_slot];
+	GLsync& fence = counter_fences[counter_slot];
+	if (fence) {
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(fence);
+		fence = 0;
+		frame_stats.objects_visible = int(slot[0]);
+		frame_stats.objects_culled = int(slot[1]);
+		frame_stats.objects_occluded = int(slot[2]);
+	}
+	slot[0] = 0;
+	slot[1] = 0;
+	slot[2] = 0;
+
+	Frustum frustum = extractFrustum(view_projection);
+	GLsizei command_count = GLsizei(scene_commands.size());
+
+	glUseProgram(cull_program);
+	glUniform4fv(0, 6, &frustum.planes[0].x);
+	glUniform1ui(6, GLuint(command_count));
+	glUniformMatrix4fv(7, 1, GL_FALSE, &view_projection[0][0]);
+	glUniform1i(11, hiz_texture != 0);
+	if (hiz_texture) { glBindTextureUnit(0, hiz_texture); }
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, command_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, culled_command_buffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, counter_buffers[counter_slot]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, draw_buffer);
+	glDispatchCompute((command_count + 63) / 64, 1, 1);
+
+	// indirect draws read the commands, the CPU reads the counters
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	counter_slot = (counter_slot + 1) % UNIFORM_RING_FRAMES;
+}
+
+IndirectDraw staticSceneDraw(GLsizei first_command, GLsizei command_count)
+{
+	if (first_command < 0 || first_command + command_count > GLsizei(scene_commands.size())) {
+		throw "ERROR::STATIC_SCENE::Command range out of bounds.";
+	}
+	IndirectDraw draw = IndirectDraw();
+	draw.vao = scene_vao;
+	draw.command_buffer = GPU_FRUSTUM_CULLING ? culled_command_buffer : command_buffer;
+	draw.draw_buffer = draw_buffer;
+	draw.first_command = first_command;
+	draw.command_count = command_count;
+	return draw;
+}
+
+void drawIndirect(const IndirectDraw& draw)
+{
+	const void* offset = reinterpret_cast<const void*>(draw.first_command * sizeof(DrawElementsIndirectCommand));
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, offset, draw.command_count, 0);
+}
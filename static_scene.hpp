@@ -0,0 +1,54 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== STATIC SCENE ==================== */
+
+// Static meshes packed into one vertex and one index buffer, every mesh is one indirect command and
+// one DrawData record. Consecutive commands sharing a texture are drawn with a single glMultiDrawElementsIndirect,
+// base_instance holds the command index so the vertex shader finds its DrawData with gl_BaseInstanceARB.
+// With GPU_FRUSTUM_CULLING a compute pass copies the commands every frame and zeroes the instance
+// count of those whose bounding sphere is outside the frustum, the draws read the culled copy.
+
+// layout fixed by GL
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint  base_vertex;
+    GLuint base_instance;
+};
+
+// per-draw data in an std430 SSBO at binding 3, indexed by gl_BaseInstanceARB
+struct DrawData {
+    glm::mat4 model_matrix;
+    glm::vec4 bounding_sphere; // world space, w = radius
+    float shininess;
+    float padding[3];
+};
+
+// range of commands over the packed buffers, drawn in one call; the sub-draws of one call cannot
+// pick different textures, a sampler array index taken from DrawData would not be dynamically uniform
+struct IndirectDraw {
+    GLuint vao;
+    GLuint command_buffer;
+    GLuint draw_buffer;       // DrawData SSBO
+    GLsizei first_command;
+    GLsizei command_count;
+    GLuint texture;           // bound to unit 0, 0 = untextured
+};
+
+// appends a mesh, returns its command index, call before the MeshData is released
+GLsizei addStaticMesh(const MeshData& data, const ModelUBO& model);
+
+// uploads the packed buffers and frees the CPU copies, needs a GL context
+void buildStaticScene();
+
+// dispatches the culling pass for this frame's camera, commands behind the Hi-Z pyramid are rejected
+// too unless hiz_texture is 0; frame_stats gets the visible/culled/occluded counts of the frame
+// UNIFORM_RING_FRAMES frames ago so the readback does not stall
+void cullStaticScene(const glm::mat4& view_projection, GLuint hiz_texture);
+
+IndirectDraw staticSceneDraw(GLsizei first_command, GLsizei command_count);
+
+// expects the VAO and GL_DRAW_INDIRECT_BUFFER to be bound
+void drawIndirect(const IndirectDraw& draw);
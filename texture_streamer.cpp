@@ -0,0 +1,208 @@
+#include "texture_streamer.hpp"
+#include <chrono>
+#include <cstring>
+#include <map>
+
+struct UploadSlot {
+	GLsync fence; // last upload reading from the slot
+};
+
+struct PendingUpload {
+	GLuint* target;      // 2D textures: handle swapped in when done
+	GLuint texture;      // 2D texture being filled or the cubemap
+	int face;            // -1 for 2D textures
+	std::string name;
+	std::future<ImageData> decoding;
+	ImageData image;
+	bool decoded;
+	int next_row;
+	std::chrono::steady_clock::time_point queued;
+};
+
+static GLuint upload_ring = 0;
+static unsigned char* upload_ring_data = NULL;
+static UploadSlot upload_slots[TEXTURE_UPLOAD_SLOTS];
+static int next_slot = 0;
+
+static GLuint placeholder_texture = 0;
+static std::vector<PendingUpload*> pending_uploads;
+static std::map<GLuint, int> cubemap_faces_left;
+
+void initTextureStreaming()
+{
+	// persistent + coherent, written by the CPU while the GPU reads other slots
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &upload_ring);
+	glNamedBufferStorage(upload_ring, TEXTURE_UPLOAD_SLOTS * TEXTURE_UPLOAD_SLOT_SIZE, NULL, flags);
+	upload_ring_data = static_cast<unsigned char*>(glMapNamedBufferRange(upload_ring, 0, TEXTURE_UPLOAD_SLOTS * TEXTURE_UPLOAD_SLOT_SIZE, flags));
+	for (int i = 0; i < TEXTURE_UPLOAD_SLOTS; i++) {
+		upload_slots[i].fence = 0;
+	}
+
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+	glCreateTextures(GL_TEXTURE_2D, 1, &placeholder_texture);
+	glTextureStorage2D(placeholder_texture, 1, GL_RGBA8, 1, 1);
+	glTextureSubImage2D(placeholder_texture, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+}
+
+GLuint placeholderTexture()
+{
+	return placeholder_texture;
+}
+
+static void queueUpload(GLuint* target, GLuint texture, int face, std::future<ImageData>& image, const char* name)
+{
+	PendingUpload* upload = new PendingUpload();
+	upload->target = target;
+	upload->texture = texture;
+	upload->face = face;
+	upload->name = name;
+	upload->decoding = std::move(image);
+	upload->decoded = false;
+	upload->next_row = 0;
+	upload->queued = std::chrono::steady_clock::now();
+	pending_uploads.push_back(upload);
+}
+
+void streamTexture(GLuint* texture, std::future<ImageData> image, const char* name)
+{
+	*texture = placeholder_texture;
+	queueUpload(texture, 0, -1, image, name);
+}
+
+void streamCubemapFace(GLuint cubemap, int face, std::future<ImageData> image, const char* name)
+{
+	cubemap_faces_left[cubemap]++;
+	queueUpload(NULL, cubemap, face, image, name);
+}
+
+// waits for the slot's previous upload, returns false when it is still in flight and wait is not allowed
+static bool acquireSlot(int slot, bool wait)
+{
+	GLsync& fence = upload_slots[slot].fence;
+	if (!fence) { return true; }
+
+	// a waiting caller keeps waiting past the timeout, a flush has to finish
+	GLenum status;
+	do {
+		status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GLuint64(1000000000) : 0);
+	} while (wait && status == GL_TIMEOUT_EXPIRED);
+	if (status == GL_WAIT_FAILED) {
+		throw "ERROR::TEXTURESTREAMER::Waiting for an upload slot failed.";
+	}
+	if (status == GL_TIMEOUT_EXPIRED) { return false; }
+
+	glDeleteSync(fence);
+	fence = 0;
+	return true;
+}
+
+static void finishUpload(PendingUpload& upload)
+{
+	if (upload.face < 0) {
+		glGenerateTextureMipmap(upload.texture);
+		glTextureParameteri(upload.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTextureParameteri(upload.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		*upload.target = upload.texture;
+	}
+	else if (--cubemap_faces_left[upload.texture] == 0) {
+		glGenerateTextureMipmap(upload.texture);
+		cubemap_faces_left.erase(upload.texture);
+	}
+	freeImage(upload.image);
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - upload.queued;
+	std::ostringstream log;
+	log << upload.name << " streamed in " << elapsed.count() << " ms after queueing\n";
+	std::cout << log.str();
+}
+
+// copies row bands of the upload through free slots, true when the whole image is on the GPU
+static bool uploadRows(PendingUpload& upload, size_t& byte_budget, bool wait)
+{
+	const ImageData& image = upload.image;
+	size_t row_size = size_t(image.width) * 4;
+	int rows_per_slot = int(TEXTURE_UPLOAD_SLOT_SIZE / row_size);
+	if (rows_per_slot == 0) {
+		throw "ERROR::TEXTURESTREAMER::Image row does not fit an upload slot.";
+	}
+
+	while (upload.next_row < image.height) {
+		int rows = std::min(rows_per_slot, image.height - upload.next_row);
+		size_t bytes = size_t(rows) * row_size;
+		// at least one band per frame, even when it is larger than the budget
+		if (!wait && byte_budget == 0) { return false; }
+		if (!acquireSlot(next_slot, wait)) { return false; }
+
+		size_t offset = size_t(next_slot) * TEXTURE_UPLOAD_SLOT_SIZE;
+		std::memcpy(upload_ring_data + offset, image.pixels + size_t(upload.next_row) * row_size, bytes);
+
+		// the pointer argument is an offset into the bound unpack buffer
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_ring);
+		if (upload.face < 0) {
+			glTextureSubImage2D(upload.texture, 0, 0, upload.next_row, image.width, rows,
+				GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offset));
+		}
+		else {
+			glTextureSubImage3D(upload.texture, 0, 0, upload.next_row, upload.face, image.width, rows, 1,
+				GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offset));
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		upload_slots[next_slot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		next_slot = (next_slot + 1) % TEXTURE_UPLOAD_SLOTS;
+
+		upload.next_row += rows;
+		byte_budget = bytes < byte_budget ? byte_budget - bytes : 0;
+	}
+	return true;
+}
+
+static void processUploads(size_t byte_budget, bool wait)
+{
+	for (size_t i = 0; i < pending_uploads.size(); ) {
+		PendingUpload& upload = *pending_uploads[i];
+
+		if (!upload.decoded) {
+			if (!wait && upload.decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				i++;
+				continue;
+			}
+			upload.image = upload.decoding.get();
+			upload.decoded = true;
+
+			if (upload.face < 0) {
+				glCreateTextures(GL_TEXTURE_2D, 1, &upload.texture);
+				glTextureStorage2D(upload.texture, std::log2(upload.image.width), GL_RGBA8, upload.image.width, upload.image.height);
+			}
+		}
+
+		if (!uploadRows(upload, byte_budget, wait)) {
+			// out of budget or slots, continue next frame in the same order
+			return;
+		}
+
+		finishUpload(upload);
+		delete pending_uploads[i];
+		pending_uploads.erase(pending_uploads.begin() + i);
+	}
+}
+
+void updateTextureStreaming(size_t byte_budget)
+{
+	if (!pending_uploads.empty()) {
+		processUploads(byte_budget, false);
+	}
+}
+
+void flushTextureStreaming()
+{
+	while (!pending_uploads.empty()) {
+		processUploads(0, true);
+	}
+}
+
+bool texturesStreaming()
+{
+	return !pending_uploads.empty();
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "application.hpp"
+#include <future>
+
+/* ==================== TEXTURE STREAMING ==================== */
+
+// Decoded images are copied into a ring of persistently mapped pixel unpack buffers and uploaded
+// from there in row bands, a fence per slot tells when a slot can be reused. Uploads are spread
+// over frames with a byte budget, so textures stream in after the first frame.
+
+// creates the PBO ring and the placeholder texture, needs a GL context
+void initTextureStreaming();
+
+// 1x1 grey texture bound until the real one has been uploaded
+GLuint placeholderTexture();
+
+// *texture holds the placeholder until the image is uploaded and mipmapped, then the new texture
+void streamTexture(GLuint* texture, std::future<ImageData> image, const char* name);
+
+// uploads into one face of a cubemap with allocated storage, mipmaps are built when all faces are in
+void streamCubemapFace(GLuint cubemap, int face, std::future<ImageData> image, const char* name);
+
+// called once per frame, copies at most byte_budget bytes and never waits for the GPU or decoders
+void updateTextureStreaming(size_t byte_budget);
+
+// uploads everything that is still pending, blocking
+void flushTextureStreaming();
+
+bool texturesStreaming();
@@ -0,0 +1,71 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+
+/* ==================== THREAD POOL ==================== */
+
+// fixed set of worker threads consuming a FIFO job queue, queued jobs are finished on destruction
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned thread_count) : stopping(false)
+    {
+        for (unsigned i = 0; i < thread_count; i++) {
+            workers.push_back(std::thread(&ThreadPool::work, this));
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+
+    // result and exceptions of the job are delivered through the future
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F job)
+    {
+        typedef typename std::result_of<F()>::type Result;
+        std::shared_ptr<std::packaged_task<Result()> > task = std::make_shared<std::packaged_task<Result()> >(job);
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push([task]() { (*task)(); });
+        }
+        wakeup.notify_one();
+        return result;
+    }
+
+private:
+    void work()
+    {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeup.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty()) { return; }
+                job = jobs.front();
+                jobs.pop();
+            }
+            job();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()> > jobs;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping;
+};
@@ -0,0 +1,111 @@
+#include "trace.hpp"
+#include <atomic>
+#include <chrono>
+
+struct TraceEvent {
+	const char* name;
+	const char* detail;
+	uint64_t start_ns;
+	uint64_t duration_ns;
+};
+
+// written only by its thread, count is published after the event it covers
+struct ThreadTrace {
+	TraceEvent events[TRACE_RING_EVENTS];
+	std::atomic<uint64_t> count;
+	std::atomic<const char*> name;
+	int id;
+	ThreadTrace* next;
+};
+
+// every ring ever registered, pushed to the front, rings live until the process ends
+static std::atomic<ThreadTrace*> thread_traces(NULL);
+static std::atomic<int> thread_count(0);
+static thread_local ThreadTrace* thread_trace = NULL;
+
+static const std::chrono::steady_clock::time_point trace_start = std::chrono::steady_clock::now();
+
+static uint64_t nowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_start).count();
+}
+
+static ThreadTrace& currentThreadTrace()
+{
+	if (!thread_trace) {
+		ThreadTrace* trace = new ThreadTrace();
+		trace->count.store(0);
+		trace->name.store(NULL);
+		trace->id = ++thread_count;
+		trace->next = thread_traces.load();
+		while (!thread_traces.compare_exchange_weak(trace->next, trace)) {}
+		thread_trace = trace;
+	}
+	return *thread_trace;
+}
+
+TraceScope::TraceScope(const char* name, const char* detail) : name(name), detail(detail), start_ns(0)
+{
+	if (CPU_TRACE) { start_ns = nowNs(); }
+}
+
+TraceScope::~TraceScope()
+{
+	if (!CPU_TRACE) { return; }
+	ThreadTrace& trace = currentThreadTrace();
+	uint64_t count = trace.count.load(std::memory_order_relaxed);
+	TraceEvent& event = trace.events[count % TRACE_RING_EVENTS];
+	event.name = name;
+	event.detail = detail;
+	event.start_ns = start_ns;
+	event.duration_ns = nowNs() - start_ns;
+	trace.count.store(count + 1, std::memory_order_release);
+}
+
+void traceThreadName(const char* name)
+{
+	if (CPU_TRACE) { currentThreadTrace().name.store(name); }
+}
+
+bool writeTrace(const char* file_name)
+{
+	FILE* file = std::fopen(file_name, "w");
+	if (!file) {
+		std::printf("%s: could not write the trace\n", file_name);
+		return false;
+	}
+
+	std::fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	size_t written = 0;
+	for (ThreadTrace* trace = thread_traces.load(); trace; trace = trace->next) {
+		const char* thread_name = trace->name.load();
+		if (thread_name) {
+			std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				first ? "" : ",\n", trace->id, jsonEscape(thread_name).c_str());
+			first = false;
+		}
+
+		// slot count % TRACE_RING_EVENTS is the one the thread writes next, so the oldest event is left
+		// out, and a copy is dropped when the thread wrapped around onto it while it was taken
+		uint64_t count = trace->count.load(std::memory_order_acquire);
+		uint64_t begin = count >= uint64_t(TRACE_RING_EVENTS) ? count - TRACE_RING_EVENTS + 1 : 0;
+		for (uint64_t i = begin; i < count; i++) {
+			TraceEvent event = trace->events[i % TRACE_RING_EVENTS];
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (trace->count.load(std::memory_order_relaxed) >= i + TRACE_RING_EVENTS) { continue; }
+
+			std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+				first ? "" : ",\n", jsonEscape(event.name).c_str(), trace->id, event.start_ns / 1e3, event.duration_ns / 1e3);
+			if (event.detail) { std::fprintf(file, ",\"args\":{\"detail\":\"%s\"}", jsonEscape(event.detail).c_str()); }
+			std::fprintf(file, "}");
+			first = false;
+			written++;
+		}
+	}
+	std::fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	std::fclose(file);
+
+	std::printf("%s: %zu trace events\n", file_name, written);
+	return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "application.hpp"
+#include <stdint.h>
+
+/* ==================== CPU TRACE ==================== */
+
+// Scoped CPU timing markers. Every thread writes complete events into its own ring of
+// TRACE_RING_EVENTS entries without locks, the ring registers itself once on the thread's first
+// event. writeTrace dumps all rings as Chrome trace_event JSON, viewable in Perfetto or
+// chrome://tracing. Older events are overwritten when a ring wraps.
+
+// records name from construction to destruction, name and detail must outlive the trace (literals)
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, const char* detail = NULL);
+    ~TraceScope();
+
+private:
+    const char* name;
+    const char* detail;
+    uint64_t start_ns;
+};
+
+// label of the calling thread in the trace, a literal
+void traceThreadName(const char* name);
+
+// writes the events of all threads, events recorded while writing may be missing or cut short
+bool writeTrace(const char* file_name);
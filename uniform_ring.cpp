@@ -0,0 +1,149 @@
+#include "uniform_ring.hpp"
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+static GLuint uniform_ring = 0;
+static unsigned char* uniform_ring_data = NULL;
+static GLsync frame_fences[UNIFORM_RING_FRAMES];
+static GLint offset_alignment = 256;
+static GLint storage_alignment = 256;
+static int frame_index = 0;
+static GLsizeiptr frame_offset = 0;
+
+// shader storage regions, sized by the largest frame so far
+static GLuint storage_ring = 0;
+static unsigned char* storage_ring_data = NULL;
+static GLsizeiptr storage_frame_size = 0;
+static GLsizeiptr storage_offset = 0;
+
+// replaced storage buffers, deleted when the frame that last used them has finished
+struct RetiredBuffer {
+	GLuint buffer;
+	long frame;
+};
+static std::vector<RetiredBuffer> retired_buffers;
+static long frame_serial = 0;
+
+static GLsizeiptr alignUp(GLsizeiptr value, GLsizeiptr alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// new storage buffer with regions of at least needed bytes, allocations made earlier in this frame
+// stay valid in the old one
+static void growStorageRing(GLsizeiptr needed)
+{
+	GLsizeiptr size = std::max(storage_frame_size, STORAGE_RING_FRAME_SIZE);
+	while (size < needed) { size *= 2; }
+	if (storage_ring) {
+		RetiredBuffer retired = { storage_ring, frame_serial };
+		retired_buffers.push_back(retired);
+		std::printf("storage ring: %ld KB per frame\n", long(size / 1024));
+	}
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &storage_ring);
+	glNamedBufferStorage(storage_ring, UNIFORM_RING_FRAMES * size, NULL, flags);
+	storage_ring_data = static_cast<unsigned char*>(glMapNamedBufferRange(storage_ring, 0, UNIFORM_RING_FRAMES * size, flags));
+	if (!storage_ring_data) {
+		throw "ERROR::UNIFORMRING::Could not map the storage ring.";
+	}
+	storage_frame_size = size;
+	storage_offset = 0;
+}
+
+void initUniformRing()
+{
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &uniform_ring);
+	glNamedBufferStorage(uniform_ring, UNIFORM_RING_FRAMES * UNIFORM_RING_FRAME_SIZE, NULL, flags);
+	uniform_ring_data = static_cast<unsigned char*>(glMapNamedBufferRange(uniform_ring, 0, UNIFORM_RING_FRAMES * UNIFORM_RING_FRAME_SIZE, flags));
+
+	for (int i = 0; i < UNIFORM_RING_FRAMES; i++) {
+		frame_fences[i] = 0;
+	}
+	growStorageRing(STORAGE_RING_FRAME_SIZE);
+}
+
+void beginUniformFrame()
+{
+	GLsync& fence = frame_fences[frame_index];
+	if (fence) {
+		// normally signaled long ago, only blocks when the GPU is UNIFORM_RING_FRAMES frames behind
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+	frame_offset = 0;
+	storage_offset = 0;
+
+	// the fence above covers the last frame that can have used a buffer retired UNIFORM_RING_FRAMES frames ago
+	for (size_t i = 0; i < retired_buffers.size(); ) {
+		if (retired_buffers[i].frame <= frame_serial - UNIFORM_RING_FRAMES) {
+			glDeleteBuffers(1, &retired_buffers[i].buffer);
+			retired_buffers.erase(retired_buffers.begin() + i);
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+UniformAllocation allocateUniforms(const void* data, GLsizeiptr size)
+{
+	// std140 blocks are sized in vec4 units, the binding must cover the padded size
+	GLsizeiptr padded_size = alignUp(size, 16);
+	if (frame_offset + padded_size > UNIFORM_RING_FRAME_SIZE)
+	{
+		throw "ERROR::UNIFORMRING::Frame uniform data exceeds UNIFORM_RING_FRAME_SIZE.";
+	}
+
+	UniformAllocation allocation;
+	allocation.buffer = uniform_ring;
+	allocation.offset = GLintptr(frame_index) * UNIFORM_RING_FRAME_SIZE + frame_offset;
+	allocation.size = padded_size;
+	std::memcpy(uniform_ring_data + allocation.offset, data, size);
+
+	frame_offset = alignUp(frame_offset + padded_size, offset_alignment);
+	return allocation;
+}
+
+void bindUniforms(GLuint binding, const UniformAllocation& allocation)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, uniform_ring, allocation.offset, allocation.size);
+}
+
+UniformAllocation reserveStorage(GLsizeiptr size, void** data)
+{
+	GLsizeiptr offset = alignUp(storage_offset, storage_alignment);
+	if (offset + size > storage_frame_size)
+	{
+		growStorageRing(size);
+		offset = 0;
+	}
+
+	UniformAllocation allocation;
+	allocation.buffer = storage_ring;
+	allocation.offset = GLintptr(frame_index) * storage_frame_size + offset;
+	allocation.size = size;
+	*data = storage_ring_data + allocation.offset;
+
+	storage_offset = offset + size;
+	return allocation;
+}
+
+void bindStorage(GLuint binding, const UniformAllocation& allocation)
+{
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, allocation.buffer, allocation.offset, allocation.size);
+}
+
+void endUniformFrame()
+{
+	frame_fences[frame_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	frame_index = (frame_index + 1) % UNIFORM_RING_FRAMES;
+	frame_serial++;
+}
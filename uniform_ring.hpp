@@ -0,0 +1,37 @@
+#pragma once
+#include "application.hpp"
+
+/* ==================== UNIFORM RING ==================== */
+
+// One persistently mapped uniform buffer split into UNIFORM_RING_FRAMES regions. Each frame writes
+// its CameraUBO/ModelUBO records into its own region and binds them with glBindBufferRange, a fence
+// per region keeps the CPU from overwriting data the GPU has not consumed yet. Per-frame SSBO data
+// goes to a second persistently mapped buffer with the same regions and fences; when a frame needs
+// more, a buffer with doubled regions replaces it and the old one is deleted once no frame in
+// flight reads it.
+
+struct UniformAllocation {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+// needs a GL context
+void initUniformRing();
+
+// waits until the GPU is done with the region this frame reuses
+void beginUniformFrame();
+
+// copies data into the current region at an offset aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+UniformAllocation allocateUniforms(const void* data, GLsizeiptr size);
+
+void bindUniforms(GLuint binding, const UniformAllocation& allocation);
+
+// reserves shader storage data aligned to GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, *data is
+// where the caller writes its size bytes, valid until endUniformFrame(), never runs out
+UniformAllocation reserveStorage(GLsizeiptr size, void** data);
+
+void bindStorage(GLuint binding, const UniformAllocation& allocation);
+
+// fences the region, call after the frame's last draw
+void endUniformFrame();